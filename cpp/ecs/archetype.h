@@ -1,5 +1,10 @@
 #pragma once
+#include <cassert>
+#include <memory>
+#include <utility>
+
 #include "chunk.h"
+#include "stats.h"
 #include "tuple.h"
 
 namespace ecs {
@@ -12,18 +17,51 @@ class Archetype {
   Archetype& operator=(Archetype&&) = delete;
 
  private:
-  std::unique_ptr<Tuple> tuple_;
+  std::shared_ptr<const Tuple> tuple_;
   Chunk* for_iter_ = nullptr;
+  // empty between uses.
+  std::unique_ptr<Chunk> scratch_chunks_[2];
 
  public:
-  Archetype(std::unique_ptr<Tuple>&& tuple) : tuple_(std::move(tuple)) {}
+  explicit Archetype(std::shared_ptr<const Tuple> tuple)
+      : tuple_(std::move(tuple)) {}
+
+  // an empty archetype sharing the tuple of this archetype.
+  std::unique_ptr<Archetype> fork() const {
+    return std::make_unique<Archetype>(tuple_);
+  }
 
-  Chunk* get_free_chunk() {
+  // prefer the densest non-full chunk so that live rows stay packed.
+  Chunk* get_free_chunk(const Chunk* except = nullptr) const {
+    Chunk* free_chunk = nullptr;
+    for (Chunk* chunk = for_iter_; chunk;
+         chunk = chunk->next_same_archetype_chunk()) {
+      if (chunk == except || chunk->is_full()) continue;
+      if (!free_chunk || free_chunk->count() < chunk->count()) {
+        free_chunk = chunk;
+      }
+    }
+    return free_chunk;
+  }
+  Chunk* get_sparse_chunk() const {
+    Chunk* sparse_chunk = nullptr;
     for (Chunk* chunk = for_iter_; chunk;
          chunk = chunk->next_same_archetype_chunk()) {
-      if (!chunk->is_full()) return chunk;
+      if (!sparse_chunk || sparse_chunk->count() > chunk->count()) {
+        sparse_chunk = chunk;
+      }
     }
-    return nullptr;
+    return sparse_chunk;
+  }
+
+  // a spare chunk for rearranging rows, e.g. by Registry::sort_rows().
+  // it must be left empty.
+  Chunk* scratch_chunk(std::size_t i) {
+    if (!scratch_chunks_[i]) {
+      scratch_chunks_[i] = std::make_unique<Chunk>(tuple_);
+    }
+    assert(scratch_chunks_[i]->count() == 0);
+    return scratch_chunks_[i].get();
   }
 
   void link_chunk(Chunk* chunk) {
@@ -34,15 +72,56 @@ class Archetype {
     }
     for_iter_ = chunk;
   }
+  void unlink_chunk(Chunk* chunk) {
+    if (for_iter_ == chunk) {
+      for_iter_ = chunk->next_same_archetype_chunk();
+      return;
+    }
+    for (auto it = for_iter_; it; it = it->next_same_archetype_chunk()) {
+      if (it->next_same_archetype_chunk() != chunk) continue;
+      it->link_same_archetype_chunk(chunk->next_same_archetype_chunk());
+      return;
+    }
+  }
+
+  Chunk* first_chunk() const { return for_iter_; }
 
   const Tuple* tuple() const { return tuple_.get(); }
+  const std::shared_ptr<const Tuple>& shared_tuple() const { return tuple_; }
 
+  ArchetypeStats stats() const {
+    ArchetypeStats stats;
+    stats.type_count = tuple_->type_size();
+    stats.row_size = tuple_->memory_size();
+    stats.row_padding = tuple_->padding_size();
+    for (Chunk* chunk = for_iter_; chunk;
+         chunk = chunk->next_same_archetype_chunk()) {
+      ++stats.chunk_count;
+      stats.chunk_size = chunk->buff_size();
+      stats.capacity += chunk->capacity();
+      stats.live_rows += chunk->count();
+      stats.memory_size += chunk->memory_usage();
+    }
+    for (auto& chunk : scratch_chunks_) {
+      if (chunk) stats.memory_size += chunk->memory_usage();
+    }
+    return stats;
+  }
+
+  bool is_match(const Type* const* types, std::size_t n) const {
+    return tuple_->is_match(types, n);
+  }
   template <typename... Ts>
   bool is_match() const {
     return tuple_->is_match<Ts...>();
   }
 
  public:
+  static std::unique_ptr<Archetype> make(const Type* const* types,
+                                         std::size_t n) {
+    auto tuple = Tuple::make(types, n);
+    return std::unique_ptr<Archetype>(new Archetype(std::move(tuple)));
+  }
   template <typename... Ts>
   static std::unique_ptr<Archetype> make() {
     auto tuple = Tuple::make<Ts...>();
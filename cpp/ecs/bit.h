@@ -0,0 +1,81 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace ecs {
+
+using BitWord = std::uint64_t;
+
+constexpr std::size_t BIT_WORD_BITS = 64;
+
+constexpr std::size_t bit_word_count(std::size_t n) {
+  return (n + BIT_WORD_BITS - 1) / BIT_WORD_BITS;
+}
+
+inline std::size_t count_trailing_zeros(BitWord x) {
+  assert(x != 0);
+#if defined(_MSC_VER)
+  unsigned long i = 0;
+  _BitScanForward64(&i, x);
+  return static_cast<std::size_t>(i);
+#else
+  return static_cast<std::size_t>(__builtin_ctzll(x));
+#endif
+}
+
+inline bool test_bit(const BitWord* words, std::size_t i) {
+  return (words[i / BIT_WORD_BITS] >> (i % BIT_WORD_BITS)) & 1;
+}
+inline void set_bit(BitWord* words, std::size_t i) {
+  words[i / BIT_WORD_BITS] |= BitWord(1) << (i % BIT_WORD_BITS);
+}
+inline void reset_bit(BitWord* words, std::size_t i) {
+  words[i / BIT_WORD_BITS] &= ~(BitWord(1) << (i % BIT_WORD_BITS));
+}
+
+// call f(i) for each set bit of |words|, scanning a word at a time.
+template <typename F>
+inline void for_each_bit(const BitWord* words, std::size_t word_n, F f) {
+  for (std::size_t w = 0; w < word_n; ++w) {
+    for (auto bits = words[w]; bits != 0; bits &= bits - 1) {
+      f(w * BIT_WORD_BITS + count_trailing_zeros(bits));
+    }
+  }
+}
+
+// spread the low 32 bits of |x| to the even bits.
+constexpr std::uint64_t spread_bits2(std::uint64_t x) {
+  x &= 0xffffffff;
+  x = (x | (x << 16)) & 0x0000ffff0000ffff;
+  x = (x | (x << 8)) & 0x00ff00ff00ff00ff;
+  x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0f;
+  x = (x | (x << 2)) & 0x3333333333333333;
+  x = (x | (x << 1)) & 0x5555555555555555;
+  return x;
+}
+// spread the low 21 bits of |x| to every third bit.
+constexpr std::uint64_t spread_bits3(std::uint64_t x) {
+  x &= 0x1fffff;
+  x = (x | (x << 32)) & 0x001f00000000ffff;
+  x = (x | (x << 16)) & 0x001f0000ff0000ff;
+  x = (x | (x << 8)) & 0x100f00f00f00f00f;
+  x = (x | (x << 4)) & 0x10c30c30c30c30c3;
+  x = (x | (x << 2)) & 0x1249249249249249;
+  return x;
+}
+
+// z-order curve index of a grid cell, for sorting rows spatially.
+constexpr std::uint64_t morton_code(std::uint32_t x, std::uint32_t y) {
+  return spread_bits2(x) | (spread_bits2(y) << 1);
+}
+constexpr std::uint64_t morton_code(std::uint32_t x, std::uint32_t y,
+                                    std::uint32_t z) {
+  return spread_bits3(x) | (spread_bits3(y) << 1) | (spread_bits3(z) << 2);
+}
+
+}  // namespace ecs
@@ -1,9 +1,21 @@
 #pragma once
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
-#include <vector>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <utility>
 
+#include "bit.h"
+#include "component.h"
+#include "entity.h"
 #include "function_traits.h"
+#include "sparse_set.h"
 #include "tuple.h"
 
 namespace ecs {
@@ -16,108 +28,560 @@ class Chunk {
   Chunk& operator=(Chunk&&) = delete;
 
  public:
+  // AccessTuple.
+  // the components of one row, resolved when the tuple is made.
   template <typename... Ts>
   struct AccessTuple {
     using tuple_type = std::tuple<Ts...>;
     template <std::size_t I>
     using element_type = std::tuple_element_t<I, tuple_type>;
 
-    Chunk* chunk = nullptr;
-    std::size_t index = 0;
+    std::tuple<sanitalize_t<Ts>*...> ptrs;
 
     AccessTuple() = default;
-    AccessTuple(Chunk* chunk, std::size_t index) : chunk(chunk), index(index) {}
+    explicit AccessTuple(sanitalize_t<Ts>*... ps) : ptrs(ps...) {}
+
+    // false if a sparse component is missing.
+    bool is_complete() const {
+      return std::apply([](auto*... ps) { return ((ps != nullptr) && ...); },
+                        ptrs);
+    }
 
     template <std::size_t I>
     element_type<I> get() {
-      return *chunk->get<sanitalize_t<element_type<I>>>(index);
+      return *std::get<I>(ptrs);
     }
   };
 
  private:
-  static const std::size_t BUFF_SIZE = 16 * 1024;
+  static constexpr std::size_t BUFF_SIZE = 16 * 1024;
+  static constexpr std::size_t MIN_ROW_COUNT = 8;
 
-  struct IndexDesc {
-    std::size_t next = 0;
-    bool use = false;
+  // destructs the rows still alive when the last chunk sharing the buffer
+  // is gone.
+  struct BuffDeleter {
+    std::shared_ptr<const Tuple> tuple;
+    std::size_t align;
+    std::size_t capacity;
+    std::size_t row_offset;
+
+    void operator()(std::uint8_t* p) const {
+      auto words = reinterpret_cast<const BitWord*>(p);
+      for_each_bit(words, bit_word_count(capacity), [this, p](std::size_t i) {
+        tuple->destruct(p + row_offset + tuple->memory_size() * i);
+      });
+      ::operator delete(p, std::align_val_t(align));
+    }
   };
 
  private:
-  const Tuple* tuple_ = nullptr;
-  std::vector<IndexDesc> indices_;
-  std::size_t next_index_ = 0;
-  std::size_t peak_index_ = 0;
+  std::shared_ptr<const Tuple> tuple_;
+  std::size_t buff_size_ = 0;
+  std::size_t capacity_ = 0;
+  std::size_t count_ = 0;
+  std::size_t free_word_ = 0;
+  std::size_t row_offset_ = 0;
   Chunk* next_chunk_ = nullptr;
   Chunk* next_same_archetype_chunk_ = nullptr;
-  std::uint8_t buff_[BUFF_SIZE] = {0};
+  // occupancy bits and the enabled bits of each enableable type are placed
+  // at the head of buff_, followed by rows.
+  // buff_ is shared copy-on-write with the chunks of forked registries.
+  std::shared_ptr<std::uint8_t> buff_;
 
  public:
-  Chunk(const Tuple* tuple)
-      : tuple_(tuple), indices_(BUFF_SIZE / tuple->memory_size()) {}
+  explicit Chunk(std::shared_ptr<const Tuple> tuple)
+      : tuple_(std::move(tuple)) {
+    layout(*tuple_, &buff_size_, &capacity_);
+    row_offset_ = row_offset(*tuple_, capacity_);
+    buff_ = new_buff();
+  }
 
-  std::size_t create() {
-    assert(next_index_ < capacity());
-    if (next_index_ >= peak_index_) {
-      indices_[peak_index_].next = peak_index_ + 1;
-      ++peak_index_;
+  // the rows a chunk of |tuple| holds.
+  static std::size_t capacity_of(const Tuple& tuple) {
+    std::size_t buff_size = 0, capacity = 0;
+    layout(tuple, &buff_size, &capacity);
+    return capacity;
+  }
+
+  // a chunk sharing the buffer of this chunk until either one is written.
+  std::unique_ptr<Chunk> fork() const {
+    return std::unique_ptr<Chunk>(new Chunk(this));
+  }
+
+  // exchange the rows of two chunks of the same tuple.
+  void swap(Chunk* other) {
+    assert(tuple_ == other->tuple_ && capacity_ == other->capacity_);
+    std::swap(buff_, other->buff_);
+    std::swap(count_, other->count_);
+    std::swap(free_word_, other->free_word_);
+  }
+
+  // give this chunk its own copy of a buffer shared with a fork.
+  void detach() {
+    if (buff_.use_count() <= 1) return;
+    auto buff = new_buff();
+    std::memcpy(buff.get(), buff_.get(), row_offset_);
+    auto row_size = tuple_->memory_size();
+    each_index([this, &buff, row_size](std::size_t i) {
+      tuple_->copy_construct(buff.get() + row_offset_ + row_size * i, row(i));
+    });
+    buff_ = std::move(buff);
+  }
+
+  void clear() {
+    if (buff_.use_count() <= 1) {
+      each_index([this](std::size_t i) { tuple_->destruct(row(i)); });
+      std::memset(buff_.get(), 0, row_offset_);
+    } else {
+      buff_ = new_buff();
     }
-    auto index = next_index_;
-    indices_[next_index_].use = true;
-    next_index_ = indices_[next_index_].next;
+    count_ = 0;
+    free_word_ = 0;
+  }
 
-    auto ptr = buff_ + tuple_->memory_size() * index;
-    tuple_->construct(ptr);
+  std::size_t create() {
+    detach();
+    auto index = alloc();
+    tuple_->construct(row(index));
     return index;
   }
   void destroy(std::size_t index) {
-    auto ptr = buff_ + tuple_->memory_size() * index;
-    tuple_->destruct(ptr);
+    detach();
+    tuple_->destruct(row(index));
+    free(index);
+  }
+
+  // move the row at |index| of |src| into a new row of this chunk.
+  std::size_t move_from(Chunk* src, std::size_t index) {
+    assert(tuple_ == src->tuple_);
+    detach();
+    src->detach();
+    auto dst_index = alloc();
+    tuple_->move_construct(row(dst_index), src->row(index));
+    copy_enabled_bits(dst_index, src, index);
+    src->destroy(index);
+    return dst_index;
+  }
 
-    indices_[index].use = false;
-    indices_[index].next = next_index_;
-    next_index_ = index;
+  // move the row at |index| of |src| of another archetype into a new row.
+  std::size_t migrate_from(Chunk* src, std::size_t index) {
+    detach();
+    src->detach();
+    auto dst_index = alloc();
+    copy_enabled_bits(dst_index, src, index);
+    tuple_->migrate_construct(row(dst_index), src->tuple(), src->row(index));
+    src->free(index);
+    return dst_index;
+  }
+
+  // change this chunk to |tuple| of another archetype, keeping each row at
+  // its index. shared types are moved a column at a time and the others
+  // default constructed. rows must be below capacity_of(*tuple).
+  void migrate_all(std::shared_ptr<const Tuple> tuple) {
+    Chunk dst(std::move(tuple));
+    assert(next_use(dst.capacity_) >= capacity_);
+    detach();
+
+    auto src_tuple = tuple_.get();
+    auto dst_tuple = dst.tuple_.get();
+    for (std::size_t t = 0; t < dst_tuple->type_size(); ++t) {
+      auto type = dst_tuple->type(t);
+      auto dst_offset = dst_tuple->offset(t);
+      std::size_t src_offset = 0;
+      if (src_tuple->try_get_offset(type, &src_offset)) {
+        each_index([&](std::size_t i) {
+          type->move(dst.row(i) + dst_offset, row(i) + src_offset);
+        });
+      } else {
+        each_index([&](std::size_t i) { type->ctor(dst.row(i) + dst_offset); });
+      }
+    }
+    each_index([this](std::size_t i) { tuple_->destruct(row(i)); });
+
+    auto word_bytes =
+        std::min(word_count(), dst.word_count()) * sizeof(BitWord);
+    std::memcpy(dst.used_words(), used_words(), word_bytes);
+    for (std::size_t t = 0; t < dst_tuple->type_size(); ++t) {
+      auto e = dst_tuple->enable_index_at(t);
+      if (e == Tuple::NPOS) continue;
+      // types new to the rows start enabled.
+      auto src_e = src_tuple->enable_index(dst_tuple->type(t));
+      auto words = src_e == Tuple::NPOS ? used_words() : enabled_words(src_e);
+      std::memcpy(dst.enabled_words(e), words, word_bytes);
+    }
+    // the old buffer has no rows left to destruct.
+    std::memset(buff_.get(), 0, row_offset_);
+
+    tuple_ = std::move(dst.tuple_);
+    buff_size_ = dst.buff_size_;
+    capacity_ = dst.capacity_;
+    free_word_ = 0;
+    row_offset_ = dst.row_offset_;
+    buff_ = std::move(dst.buff_);
+  }
+
+  // copy the row at |index| of |src| into a new row of this chunk.
+  std::size_t copy_from(Chunk* src, std::size_t index) {
+    assert(tuple_ == src->tuple_);
+    assert(src->is_use(index));
+    detach();
+    auto dst_index = alloc();
+    tuple_->copy_construct(row(dst_index), src->row(index));
+    copy_enabled_bits(dst_index, src, index);
+    return dst_index;
   }
 
   template <typename T>
   T* get(std::size_t index) {
+    detach();
+    return find<T>(index);
+  }
+  template <typename T>
+  const T* get(std::size_t index) const {
+    return find<T>(index);
+  }
+  void* get(std::size_t index, const Type* type) {
+    detach();
+    return const_cast<void*>(std::as_const(*this).get(index, type));
+  }
+  const void* get(std::size_t index, const Type* type) const {
     assert(is_use(index));
     std::size_t offset = 0;
-    if (!tuple_->try_get_offset<T>(&offset)) return nullptr;
-    auto ptr = buff_ + tuple_->memory_size() * index + offset;
-    return reinterpret_cast<T*>(ptr);
+    if (!tuple_->try_get_offset(type, &offset)) return nullptr;
+    return row(index) + offset;
+  }
+
+  // component of the row at |index|, looked up in |sparse_sets| when
+  // T is stored in a sparse set.
+  template <typename T>
+  T* get_component(std::size_t index, SparseSets* sparse_sets) {
+    if constexpr (is_sparse_v<T>) {
+      auto set = sparse_sets ? sparse_sets->find<T>() : nullptr;
+      return set ? set->find(find<EntityId>(index)->index) : nullptr;
+    } else {
+      return get<T>(index);
+    }
+  }
+  template <typename T>
+  const T* get_component(std::size_t index,
+                         const SparseSets* sparse_sets) const {
+    if constexpr (is_sparse_v<T>) {
+      auto set = sparse_sets ? sparse_sets->find<T>() : nullptr;
+      return set ? set->find(find<EntityId>(index)->index) : nullptr;
+    } else {
+      return find<T>(index);
+    }
+  }
+  template <typename... Ts>
+  bool has_components(std::size_t index, const SparseSets* sparse_sets) const {
+    return ((get_component<sanitalize_t<Ts>>(index, sparse_sets) != nullptr) &&
+            ...);
+  }
+
+  template <typename T>
+  bool is_enabled(std::size_t index) const {
+    auto e = tuple_->enable_index(Type::get<T>());
+    return e == Tuple::NPOS || test_bit(enabled_words(e), index);
+  }
+  template <typename... Ts>
+  bool are_enabled(std::size_t index) const {
+    return (is_enabled<sanitalize_t<Ts>>(index) && ...);
+  }
+  template <typename T>
+  bool set_enabled(std::size_t index, bool enabled) {
+    assert(is_use(index));
+    auto e = tuple_->enable_index(Type::get<T>());
+    if (e == Tuple::NPOS) return false;
+    detach();
+    if (enabled) {
+      set_bit(enabled_words(e), index);
+    } else {
+      reset_bit(enabled_words(e), index);
+    }
+    return true;
+  }
+
+  // the occupancy words and the enabled words of the enableable Ts.
+  // a row passes when its bit is set in each; resolve once per chunk.
+  template <typename... Ts>
+  auto row_masks() const {
+    return row_masks(enableable_types_t<Ts...>{});
+  }
+  template <typename... Ts>
+  std::array<const BitWord*, 1 + sizeof...(Ts)> row_masks(
+      type_list<Ts...>) const {
+    std::array<const BitWord*, 1 + sizeof...(Ts)> masks = {
+        used_words(), enabled_words_of<sanitalize_t<Ts>>()...};
+    assert(std::find(masks.begin(), masks.end(), nullptr) == masks.end());
+    return masks;
+  }
+
+  // first row at or after |i| passing |masks|, or capacity() if there is
+  // none.
+  template <std::size_t N>
+  std::size_t next_masked(std::size_t i,
+                          const std::array<const BitWord*, N>& masks) const {
+    auto w = i / BIT_WORD_BITS;
+    auto word_n = word_count();
+    if (w >= word_n) return capacity_;
+    auto bits = masked_word(masks, w) & (~BitWord(0) << (i % BIT_WORD_BITS));
+    while (bits == 0) {
+      if (++w >= word_n) return capacity_;
+      bits = masked_word(masks, w);
+    }
+    return w * BIT_WORD_BITS + count_trailing_zeros(bits);
+  }
+
+  // call f(i) for each used row whose enableable Ts are all enabled,
+  // masking a word of rows at a time.
+  template <typename... Ts, typename F>
+  void each_index(F f) const {
+    auto masks = row_masks<Ts...>();
+    for (std::size_t w = 0, word_n = word_count(); w < word_n; ++w) {
+      for (auto bits = masked_word(masks, w); bits != 0; bits &= bits - 1) {
+        f(w * BIT_WORD_BITS + count_trailing_zeros(bits));
+      }
+    }
   }
 
   template <typename... Ts>
-  AccessTuple<Ts...> as_tuple(std::size_t index) {
+  AccessTuple<Ts...> as_tuple(std::size_t index,
+                              SparseSets* sparse_sets = nullptr) {
     assert(is_use(index));
-    return AccessTuple<Ts...>(this, index);
+    if constexpr ((is_writable_v<Ts> || ...)) {
+      detach();
+    }
+    auto self = static_cast<const Chunk*>(this);
+    return AccessTuple<Ts...>(const_cast<sanitalize_t<Ts>*>(
+        self->get_component<sanitalize_t<Ts>>(index, sparse_sets))...);
+  }
+
+  // offset of T in a row, or Tuple::NPOS. resolve once per chunk and
+  // address rows with at_offset().
+  template <typename T>
+  std::size_t offset_of() const {
+    std::size_t offset = Tuple::NPOS;
+    tuple_->try_get_offset<T>(&offset);
+    return offset;
+  }
+  // does not detach; detach() first to write.
+  template <typename T>
+  T* at_offset(std::size_t index, std::size_t offset) const {
+    assert(is_use(index) && offset != Tuple::NPOS);
+    return reinterpret_cast<T*>(row(index) + offset);
   }
 
   template <typename F, typename... Ts>
   void each(F f, type_list<Ts...>) {
-    for (std::size_t i = 0; i < peak_index_; ++i) {
-      if (!indices_[i].use) continue;
-      f(*get<sanitalize_t<Ts>>(i)...);
+    if constexpr ((is_writable_v<Ts> || ...)) {
+      detach();
+    }
+    each_index<Ts...>(
+        [this, &f](std::size_t i) { f(*find<sanitalize_t<Ts>>(i)...); });
+  }
+  template <typename F, typename... Ts>
+  void each(F f, type_list<Ts...> args, SparseSets* sparse_sets) {
+    if constexpr (!(is_sparse_v<Ts> || ...)) {
+      each(f, args);
+    } else {
+      if constexpr ((is_writable_v<Ts> || ...)) {
+        detach();
+      }
+      auto self = static_cast<const Chunk*>(this);
+      each_index<Ts...>([&](std::size_t i) {
+        auto ptrs = std::make_tuple(const_cast<sanitalize_t<Ts>*>(
+            self->get_component<sanitalize_t<Ts>>(i, sparse_sets))...);
+        std::apply(
+            [&f](auto*... ps) {
+              if ((ps && ...)) f(*ps...);
+            },
+            ptrs);
+      });
+    }
+  }
+
+  // call f(columns) for each row, with columns[k] pointing at |offsets[k]|
+  // of the row. |columns| is scratch space for |n| pointers.
+  template <typename F>
+  void each_raw(F f, const std::size_t* offsets, std::size_t n,
+                void** columns) {
+    detach();
+    each_index([&](std::size_t i) {
+      auto p = row(i);
+      for (std::size_t k = 0; k < n; ++k) {
+        columns[k] = p + offsets[k];
+      }
+      f(static_cast<void* const*>(columns));
+    });
+  }
+
+  template <typename F, typename... Ts>
+  void apply(std::size_t index, F f, type_list<Ts...>) {
+    assert(is_use(index));
+    f(*get<sanitalize_t<Ts>>(index)...);
+  }
+
+  // first used index at or after |i|, or capacity() if there is none.
+  std::size_t next_use(std::size_t i) const {
+    auto words = used_words();
+    auto w = i / BIT_WORD_BITS;
+    if (w >= word_count()) return capacity_;
+    auto bits = words[w] & (~BitWord(0) << (i % BIT_WORD_BITS));
+    while (bits == 0) {
+      if (++w >= word_count()) return capacity_;
+      bits = words[w];
     }
+    return w * BIT_WORD_BITS + count_trailing_zeros(bits);
   }
 
-  std::size_t capacity() const { return indices_.size(); }
-  std::size_t size() const { return peak_index_; }
-  bool is_full() const { return next_index_ >= indices_.size(); }
-  bool is_use(std::size_t i) const { return indices_[i].use; }
+  std::size_t capacity() const { return capacity_; }
+  std::size_t count() const { return count_; }
+  std::size_t buff_size() const { return buff_size_; }
+  std::size_t memory_usage() const { return sizeof(Chunk) + buff_size_; }
+  bool is_full() const { return count_ >= capacity_; }
+  bool is_use(std::size_t i) const { return test_bit(used_words(), i); }
 
   template <typename... Ts>
   bool contains() {
     return tuple_->contains<Ts...>();
   }
+  template <typename... Ts>
+  bool contains(type_list<Ts...>) {
+    return tuple_->contains<Ts...>();
+  }
+  // |types| must be sorted by type_less.
+  bool contains(const Type* const* types, std::size_t n) const {
+    return tuple_->contains(types, n);
+  }
 
-  Chunk* next_chunk() { return next_chunk_; }
-  Chunk* next_same_archetype_chunk() { return next_same_archetype_chunk_; }
+  const Tuple* tuple() const { return tuple_.get(); }
+  // identifies the buffer, which a fork shares until either side writes.
+  const void* buffer() const { return buff_.get(); }
+  Chunk* next_chunk() const { return next_chunk_; }
+  Chunk* next_same_archetype_chunk() const {
+    return next_same_archetype_chunk_;
+  }
 
   void link_chunk(Chunk* chunk) { next_chunk_ = chunk; }
   void link_same_archetype_chunk(Chunk* chunk) {
     next_same_archetype_chunk_ = chunk;
   }
+
+ private:
+  explicit Chunk(const Chunk* src)
+      : tuple_(src->tuple_),
+        buff_size_(src->buff_size_),
+        capacity_(src->capacity_),
+        count_(src->count_),
+        free_word_(src->free_word_),
+        row_offset_(src->row_offset_),
+        buff_(src->buff_) {}
+
+  std::shared_ptr<std::uint8_t> new_buff() const {
+    auto align = std::max(tuple_->align(), alignof(std::max_align_t));
+    auto p = static_cast<std::uint8_t*>(
+        ::operator new(buff_size_, std::align_val_t(align)));
+    std::memset(p, 0, row_offset_);
+    return std::shared_ptr<std::uint8_t>(
+        p, BuffDeleter{tuple_, align, capacity_, row_offset_});
+  }
+
+  template <typename T>
+  T* find(std::size_t index) const {
+    assert(is_use(index));
+    std::size_t offset = 0;
+    if (!tuple_->try_get_offset<T>(&offset)) return nullptr;
+    return reinterpret_cast<T*>(row(index) + offset);
+  }
+
+  static std::size_t row_offset(const Tuple& tuple, std::size_t capacity) {
+    auto word_n = bit_word_count(capacity) * (1 + tuple.enableable_size());
+    auto offset = word_n * sizeof(BitWord);
+    auto r = offset % tuple.align();
+    return r == 0 ? offset : offset + tuple.align() - r;
+  }
+  static void layout(const Tuple& tuple, std::size_t* buff_size,
+                     std::size_t* capacity) {
+    auto row_size = tuple.memory_size();
+    // large rows get a larger buffer rather than a chunk of a few rows.
+    *buff_size = std::max(BUFF_SIZE, row_offset(tuple, MIN_ROW_COUNT) +
+                                         row_size * MIN_ROW_COUNT);
+    *capacity = *buff_size / row_size;
+    while (row_offset(tuple, *capacity) + row_size * *capacity > *buff_size) {
+      --*capacity;
+    }
+  }
+  std::uint8_t* row(std::size_t index) const {
+    return buff_.get() + row_offset_ + tuple_->memory_size() * index;
+  }
+
+  std::size_t word_count() const { return bit_word_count(capacity_); }
+  BitWord* used_words() { return reinterpret_cast<BitWord*>(buff_.get()); }
+  const BitWord* used_words() const {
+    return reinterpret_cast<const BitWord*>(buff_.get());
+  }
+  BitWord* enabled_words(std::size_t e) {
+    return used_words() + (1 + e) * word_count();
+  }
+  const BitWord* enabled_words(std::size_t e) const {
+    return used_words() + (1 + e) * word_count();
+  }
+  template <typename T>
+  const BitWord* enabled_words_of() const {
+    if constexpr (is_enableable_v<T>) {
+      auto e = tuple_->enable_index(Type::get<T>());
+      return e == Tuple::NPOS ? nullptr : enabled_words(e);
+    } else {
+      return nullptr;
+    }
+  }
+
+  template <std::size_t N>
+  static BitWord masked_word(const std::array<const BitWord*, N>& masks,
+                             std::size_t w) {
+    auto bits = masks[0][w];
+    for (std::size_t k = 1; k < N; ++k) {
+      bits &= masks[k][w];
+    }
+    return bits;
+  }
+
+  void copy_enabled_bits(std::size_t index, const Chunk* src,
+                         std::size_t src_index) {
+    for (std::size_t i = 0; i < tuple_->type_size(); ++i) {
+      auto e = tuple_->enable_index_at(i);
+      if (e == Tuple::NPOS) continue;
+      auto src_e = src->tuple_ == tuple_
+                       ? e
+                       : src->tuple_->enable_index(tuple_->type(i));
+      if (src_e == Tuple::NPOS) continue;
+      if (test_bit(src->enabled_words(src_e), src_index)) {
+        set_bit(enabled_words(e), index);
+      } else {
+        reset_bit(enabled_words(e), index);
+      }
+    }
+  }
+
+  std::size_t alloc() {
+    assert(!is_full());
+    auto words = used_words();
+    while (~words[free_word_] == 0) ++free_word_;
+    auto index =
+        free_word_ * BIT_WORD_BITS + count_trailing_zeros(~words[free_word_]);
+    assert(index < capacity_);
+    set_bit(words, index);
+    for (std::size_t e = 0; e < tuple_->enableable_size(); ++e) {
+      set_bit(enabled_words(e), index);
+    }
+    ++count_;
+    return index;
+  }
+  void free(std::size_t index) {
+    reset_bit(used_words(), index);
+    free_word_ = std::min(free_word_, index / BIT_WORD_BITS);
+    --count_;
+  }
 };
 
 }  // namespace ecs
@@ -0,0 +1,110 @@
+#pragma once
+#include <type_traits>
+#include <utility>
+
+#include "function_traits.h"
+
+namespace ecs {
+
+enum class StorageType {
+  Table,
+  SparseSet,
+};
+
+// component_traits.
+// specializations may define only the members they change.
+template <typename T>
+struct component_traits {
+  static constexpr StorageType storage = StorageType::Table;
+  static constexpr bool enableable = false;
+};
+
+namespace detail {
+
+template <typename T>
+using component_t = std::remove_const_t<std::remove_reference_t<T>>;
+
+template <typename T, typename = void>
+struct storage_of
+    : std::integral_constant<StorageType, StorageType::Table> {};
+template <typename T>
+struct storage_of<T, std::void_t<decltype(component_traits<T>::storage)>>
+    : std::integral_constant<StorageType, component_traits<T>::storage> {};
+
+template <typename T, typename = void>
+struct enableable_of : std::false_type {};
+template <typename T>
+struct enableable_of<T, std::void_t<decltype(component_traits<T>::enableable)>>
+    : std::bool_constant<component_traits<T>::enableable> {};
+
+}  // namespace detail
+
+template <typename T>
+inline constexpr bool is_sparse_v =
+    detail::storage_of<detail::component_t<T>>::value ==
+    StorageType::SparseSet;
+
+// T is accessed through a mutable reference.
+template <typename T>
+inline constexpr bool is_writable_v =
+    std::is_lvalue_reference_v<T> &&
+    !std::is_const_v<std::remove_reference_t<T>>;
+
+// enableable components can be disabled per row without moving the row.
+template <typename T>
+inline constexpr bool is_enableable_v =
+    detail::enableable_of<detail::component_t<T>>::value;
+
+namespace detail {
+
+template <typename Out, typename... Ts>
+struct table_types;
+
+template <typename... Os>
+struct table_types<type_list<Os...>> {
+  using type = type_list<Os...>;
+};
+
+template <typename... Os, typename T, typename... Ts>
+struct table_types<type_list<Os...>, T, Ts...>
+    : table_types<std::conditional_t<is_sparse_v<T>, type_list<Os...>,
+                                     type_list<Os..., T>>,
+                  Ts...> {};
+
+template <typename Out, typename... Ts>
+struct enableable_types;
+
+template <typename... Os>
+struct enableable_types<type_list<Os...>> {
+  using type = type_list<Os...>;
+};
+
+template <typename... Os, typename T, typename... Ts>
+struct enableable_types<type_list<Os...>, T, Ts...>
+    : enableable_types<
+          std::conditional_t<is_enableable_v<T> && !is_sparse_v<T>,
+                             type_list<Os..., T>, type_list<Os...>>,
+          Ts...> {};
+
+}  // namespace detail
+
+// types of Ts stored in archetype chunks.
+template <typename... Ts>
+using table_types_t = typename detail::table_types<type_list<>, Ts...>::type;
+
+// types of Ts with enabled bits in archetype chunks.
+template <typename... Ts>
+using enableable_types_t =
+    typename detail::enableable_types<type_list<>, Ts...>::type;
+
+// construct T with braces for aggregates, parentheses otherwise.
+template <typename T, typename... Args>
+inline T make_component(Args&&... args) {
+  if constexpr (std::is_aggregate_v<T>) {
+    return T{std::forward<Args>(args)...};
+  } else {
+    return T(std::forward<Args>(args)...);
+  }
+}
+
+}  // namespace ecs
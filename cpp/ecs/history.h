@@ -0,0 +1,71 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "registry.h"
+
+namespace ecs {
+
+// RegistryHistory.
+// ring of the last N forks of a registry to roll back to.
+class RegistryHistory final {
+ private:
+  RegistryHistory(const RegistryHistory&) = delete;
+  RegistryHistory(RegistryHistory&&) = delete;
+  RegistryHistory& operator=(const RegistryHistory&) = delete;
+  RegistryHistory& operator=(RegistryHistory&&) = delete;
+
+ private:
+  std::vector<std::unique_ptr<Registry>> frames_;
+  std::size_t head_ = 0;
+  std::size_t size_ = 0;
+
+ public:
+  explicit RegistryHistory(std::size_t n) : frames_(n) { assert(n > 0); }
+
+  // record the current state of |registry|, dropping the oldest frame when
+  // the ring is full.
+  void push(Registry* registry) {
+    head_ = (head_ + 1) % frames_.size();
+    frames_[head_] = registry->fork();
+    size_ = std::min(size_ + 1, frames_.size());
+  }
+
+  // frame |n| frames back from the latest, or nullptr.
+  const Registry* get(std::size_t n) const {
+    if (n >= size_) return nullptr;
+    return frames_[index_of(n)].get();
+  }
+
+  // drop the frames newer than |n| frames back and return a fork of it to
+  // continue from. the frame stays in the ring to roll back again.
+  std::unique_ptr<Registry> rollback(std::size_t n) {
+    if (n >= size_) return nullptr;
+    for (std::size_t i = 0; i < n; ++i) {
+      frames_[index_of(i)].reset();
+    }
+    head_ = index_of(n);
+    size_ -= n;
+    return frames_[head_]->fork();
+  }
+
+  std::size_t size() const { return size_; }
+  std::size_t capacity() const { return frames_.size(); }
+
+  void clear() {
+    for (auto& frame : frames_) {
+      frame.reset();
+    }
+    size_ = 0;
+  }
+
+ private:
+  std::size_t index_of(std::size_t n) const {
+    return (head_ + frames_.size() - n) % frames_.size();
+  }
+};
+
+}  // namespace ecs
@@ -0,0 +1,164 @@
+#pragma once
+#include <cstddef>
+#include <map>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include "entity.h"
+
+namespace ecs {
+
+class IndexBase {
+ public:
+  virtual ~IndexBase() = default;
+
+  // reindex |id| with its component |value|, or drop it if |value| is null.
+  virtual void update(EntityId id, const void* value) = 0;
+  virtual void erase(EntityId id) = 0;
+  virtual void clear() = 0;
+};
+
+// HashIndex.
+// entities keyed by a field of T, for equality lookups.
+template <typename T, typename F>
+class HashIndex final : public IndexBase {
+ public:
+  using key_type = std::decay_t<std::invoke_result_t<F, const T&>>;
+
+ private:
+  F key_of_;
+  std::unordered_multimap<key_type, EntityId> entities_;
+  std::unordered_map<std::size_t, key_type> keys_;
+
+ public:
+  explicit HashIndex(F f) : key_of_(std::move(f)) {}
+
+  virtual void update(EntityId id, const void* value) override {
+    if (!value) {
+      erase(id);
+      return;
+    }
+    auto key = key_of_(*static_cast<const T*>(value));
+    auto it = keys_.find(id.index);
+    if (it != keys_.end()) {
+      if (it->second == key) return;
+      erase_entity(id.index, it->second);
+      it->second = key;
+    } else {
+      keys_.emplace(id.index, key);
+    }
+    entities_.emplace(std::move(key), id);
+  }
+  virtual void erase(EntityId id) override {
+    auto it = keys_.find(id.index);
+    if (it == keys_.end()) return;
+    erase_entity(id.index, it->second);
+    keys_.erase(it);
+  }
+  virtual void clear() override {
+    entities_.clear();
+    keys_.clear();
+  }
+
+  // first entity with |key|, or an invalid id.
+  EntityId find(const key_type& key) const {
+    auto it = entities_.find(key);
+    return it != entities_.end() ? it->second : EntityId{};
+  }
+  template <typename G>
+  void each(const key_type& key, G g) const {
+    auto range = entities_.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+      g(it->second);
+    }
+  }
+  std::size_t count(const key_type& key) const {
+    return entities_.count(key);
+  }
+  std::size_t size() const { return keys_.size(); }
+
+ private:
+  void erase_entity(std::size_t index, const key_type& key) {
+    auto range = entities_.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second.index != index) continue;
+      entities_.erase(it);
+      return;
+    }
+  }
+};
+
+// OrderedIndex.
+// entities keyed by a field of T, for range lookups.
+template <typename T, typename F>
+class OrderedIndex final : public IndexBase {
+ public:
+  using key_type = std::decay_t<std::invoke_result_t<F, const T&>>;
+
+ private:
+  using map_type = std::multimap<key_type, EntityId>;
+
+ private:
+  F key_of_;
+  map_type entities_;
+  std::unordered_map<std::size_t, typename map_type::iterator> iters_;
+
+ public:
+  explicit OrderedIndex(F f) : key_of_(std::move(f)) {}
+
+  virtual void update(EntityId id, const void* value) override {
+    if (!value) {
+      erase(id);
+      return;
+    }
+    auto key = key_of_(*static_cast<const T*>(value));
+    auto it = iters_.find(id.index);
+    if (it != iters_.end()) {
+      auto& entry = *it->second;
+      if (!(entry.first < key) && !(key < entry.first)) return;
+      entities_.erase(it->second);
+      it->second = entities_.emplace(std::move(key), id);
+    } else {
+      iters_.emplace(id.index, entities_.emplace(std::move(key), id));
+    }
+  }
+  virtual void erase(EntityId id) override {
+    auto it = iters_.find(id.index);
+    if (it == iters_.end()) return;
+    entities_.erase(it->second);
+    iters_.erase(it);
+  }
+  virtual void clear() override {
+    entities_.clear();
+    iters_.clear();
+  }
+
+  // first entity with |key|, or an invalid id.
+  EntityId find(const key_type& key) const {
+    auto it = entities_.find(key);
+    return it != entities_.end() ? it->second : EntityId{};
+  }
+  template <typename G>
+  void each(const key_type& key, G g) const {
+    auto range = entities_.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+      g(it->second);
+    }
+  }
+  // call g(id) for each entity with a key in [lo, hi), in key order.
+  template <typename G>
+  void each_range(const key_type& lo, const key_type& hi, G g) const {
+    if (hi < lo) return;
+    auto end = entities_.lower_bound(hi);
+    for (auto it = entities_.lower_bound(lo); it != end; ++it) {
+      g(it->second);
+    }
+  }
+  std::size_t count(const key_type& key) const {
+    return entities_.count(key);
+  }
+  std::size_t size() const { return iters_.size(); }
+};
+
+}  // namespace ecs
@@ -0,0 +1,53 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "entity.h"
+
+namespace ecs {
+
+// Journal.
+// append-only log of entities. each reader keeps a cursor of how far it
+// has read, so that it sees every entry once.
+class Journal final {
+ public:
+  using Cursor = std::size_t;
+
+ private:
+  std::vector<EntityId> entries_;
+  // sequence number of entries_[0].
+  Cursor base_ = 0;
+
+ public:
+  void push(EntityId id) { entries_.emplace_back(id); }
+
+  // call f(id) for the entries after |*cursor| and advance it.
+  // entries dropped by trim() or clear() before being read are skipped.
+  template <typename F>
+  void read(Cursor* cursor, F f) const {
+    for (auto i = std::max(*cursor, base_) - base_; i < entries_.size(); ++i) {
+      f(entries_[i]);
+    }
+    *cursor = end();
+  }
+
+  // drop the entries before |cursor|, once every reader has passed it.
+  void trim(Cursor cursor) {
+    if (cursor <= base_) return;
+    auto n = std::min(cursor - base_, entries_.size());
+    entries_.erase(entries_.begin(), entries_.begin() + n);
+    base_ += n;
+  }
+  void clear() {
+    base_ += entries_.size();
+    entries_.clear();
+  }
+
+  Cursor begin() const { return base_; }
+  Cursor end() const { return base_ + entries_.size(); }
+  std::size_t size() const { return entries_.size(); }
+  bool empty() const { return entries_.empty(); }
+};
+
+}  // namespace ecs
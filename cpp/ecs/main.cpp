@@ -27,4 +27,7 @@ int main() {
   for (auto [id, i] : query) {
     std::cout << id << " = i: " << i << std::endl;
   }
+
+  ecs::write_json(std::cout, reg.stats());
+  std::cout << std::endl;
 }
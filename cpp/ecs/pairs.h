@@ -0,0 +1,176 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "chunk.h"
+#include "component.h"
+#include "query.h"
+
+namespace ecs {
+
+// executors of pairs(): exec(n, f) runs f(i) for each i in [0, n), possibly
+// in parallel, and returns once all of them are done. a job system plugs in
+// with a callable of the same shape.
+
+// SerialFor.
+struct SerialFor {
+  template <typename F>
+  void operator()(std::size_t n, F&& f) const {
+    for (std::size_t i = 0; i < n; ++i) f(i);
+  }
+};
+
+// ThreadFor.
+// starts and joins |thread_count| - 1 threads on every call, so it is for
+// offline work such as tools and tests, not for a frame.
+struct ThreadFor {
+  std::size_t thread_count = 1;
+
+  template <typename F>
+  void operator()(std::size_t n, F&& f) const {
+    auto thread_n = std::min(thread_count, n);
+    if (thread_n <= 1) {
+      SerialFor()(n, f);
+      return;
+    }
+    std::atomic<std::size_t> next = 0;
+    auto run = [&next, n, &f] {
+      for (auto i = next++; i < n; i = next++) f(i);
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(thread_n - 1);
+    for (std::size_t i = 1; i < thread_n; ++i) {
+      threads.emplace_back(run);
+    }
+    run();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+};
+
+namespace detail {
+
+template <typename T>
+using access_ptr_t = std::conditional_t<is_writable_v<T>, sanitalize_t<T>*,
+                                        const sanitalize_t<T>*>;
+
+template <typename... Ts>
+using row_ptrs_t = std::tuple<access_ptr_t<Ts>...>;
+
+template <typename T>
+access_ptr_t<T> access_ptr(Chunk* chunk, std::size_t index,
+                           SparseSets* sparse_sets) {
+  using U = sanitalize_t<T>;
+  if constexpr (is_writable_v<T>) {
+    return chunk->template get_component<U>(index, sparse_sets);
+  } else {
+    return std::as_const(*chunk).template get_component<U>(index, sparse_sets);
+  }
+}
+
+// component pointers of the rows of |chunk| matching Ts..., so that a tile
+// is iterated without touching the bitsets again.
+template <typename... Ts>
+void gather_rows(Chunk* chunk, SparseSets* sparse_sets,
+                 std::vector<row_ptrs_t<Ts...>>* rows) {
+  rows->clear();
+  chunk->template each_index<Ts...>([&](std::size_t i) {
+    if constexpr ((is_sparse_v<Ts> || ...)) {
+      if (!chunk->template has_components<Ts...>(i, sparse_sets)) return;
+    }
+    rows->emplace_back(access_ptr<Ts>(chunk, i, sparse_sets)...);
+  });
+}
+
+template <typename F, typename A, typename B>
+void call_pair(F& f, const A& a, const B& b) {
+  std::apply(
+      [&f, &b](auto*... as) {
+        std::apply([&f, &as...](auto*... bs) { f(*as..., *bs...); }, b);
+      },
+      a);
+}
+
+template <typename... Ts>
+std::vector<Chunk*> query_chunks(const Query<Ts...>& query) {
+  std::vector<Chunk*> chunks;
+  query.each_chunk([&chunks](Chunk* chunk) { chunks.emplace_back(chunk); });
+  return chunks;
+}
+
+template <typename Exec>
+inline constexpr bool is_serial_v =
+    std::is_same_v<std::decay_t<Exec>, SerialFor>;
+
+}  // namespace detail
+
+// call f(as..., bs...) for every pair of a row of |a| and a row of |b|.
+// rows are paired a chunk by a chunk so that both tiles stay in cache.
+// with an executor other than SerialFor the chunks of |a| may run in
+// parallel; only the components of |a| may be written then, and |b| must
+// not overlap them.
+template <typename... As, typename... Bs, typename F,
+          typename Exec = SerialFor>
+void pairs(const Query<As...>& a, const Query<Bs...>& b, F f,
+           Exec exec = {}) {
+  auto a_chunks = detail::query_chunks(a);
+  auto b_chunks = detail::query_chunks(b);
+  if constexpr (!detail::is_serial_v<Exec>) {
+    static_assert(!(is_writable_v<Bs> || ...),
+                  "b is read only in parallel pairs.");
+    // detach shared buffers up front rather than on the worker threads.
+    for (auto chunk : a_chunks) {
+      if constexpr ((is_writable_v<As> || ...)) chunk->detach();
+    }
+  }
+  exec(a_chunks.size(), [&](std::size_t i) {
+    std::vector<detail::row_ptrs_t<As...>> a_rows;
+    std::vector<detail::row_ptrs_t<Bs...>> b_rows;
+    detail::gather_rows<As...>(a_chunks[i], a.sparse_sets(), &a_rows);
+    if (a_rows.empty()) return;
+    for (auto b_chunk : b_chunks) {
+      detail::gather_rows<Bs...>(b_chunk, b.sparse_sets(), &b_rows);
+      for (auto& a_row : a_rows) {
+        for (auto& b_row : b_rows) {
+          detail::call_pair(f, a_row, b_row);
+        }
+      }
+    }
+  });
+}
+
+// call f(xs..., ys...) once for every unordered pair of distinct rows of
+// |query|. parallel executors require read only components.
+template <typename... Ts, typename F, typename Exec = SerialFor>
+void pairs(const Query<Ts...>& query, F f, Exec exec = {}) {
+  static_assert(detail::is_serial_v<Exec> || !(is_writable_v<Ts> || ...),
+                "components are read only in parallel pairs.");
+  auto chunks = detail::query_chunks(query);
+  exec(chunks.size(), [&](std::size_t i) {
+    std::vector<detail::row_ptrs_t<Ts...>> a_rows;
+    std::vector<detail::row_ptrs_t<Ts...>> b_rows;
+    detail::gather_rows<Ts...>(chunks[i], query.sparse_sets(), &a_rows);
+    for (std::size_t x = 0; x < a_rows.size(); ++x) {
+      for (auto y = x + 1; y < a_rows.size(); ++y) {
+        detail::call_pair(f, a_rows[x], a_rows[y]);
+      }
+    }
+    for (auto j = i + 1; j < chunks.size() && !a_rows.empty(); ++j) {
+      detail::gather_rows<Ts...>(chunks[j], query.sparse_sets(), &b_rows);
+      for (auto& a_row : a_rows) {
+        for (auto& b_row : b_rows) {
+          detail::call_pair(f, a_row, b_row);
+        }
+      }
+    }
+  });
+}
+
+}  // namespace ecs
@@ -1,5 +1,12 @@
 #pragma once
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
 #include "chunk.h"
+#include "component.h"
 #include "entity.h"
 #include "function_traits.h"
 
@@ -9,15 +16,22 @@ template <typename... Ts>
 class QueryIterator {
  private:
   using Tuple = Chunk::AccessTuple<Ts...>;
+  using Masks = decltype(std::declval<const Chunk&>().row_masks<Ts...>());
 
  private:
   Chunk* chunk_ = nullptr;
   std::size_t chunk_index_ = 0;
+  SparseSets* sparse_sets_ = nullptr;
+  // resolved once per chunk.
+  Masks masks_ = {};
+  std::size_t offsets_[sizeof...(Ts)] = {};
   Tuple tuple_;
 
  public:
   QueryIterator() = default;
-  QueryIterator(Chunk* chunk) : chunk_(chunk), chunk_index_(0) {
+  QueryIterator(Chunk* chunk, SparseSets* sparse_sets)
+      : chunk_(chunk), chunk_index_(0), sparse_sets_(sparse_sets) {
+    if (chunk_) resolve_chunk();
     check_index();
   }
 
@@ -38,25 +52,50 @@ class QueryIterator {
  private:
   bool check_index() {
     while (chunk_) {
-      if (chunk_index_ >= chunk_->size()) {
-        chunk_ = next_chunk();
-        chunk_index_ = 0;
-        if (!chunk_) return false;
-      }
-      if (chunk_->is_use(chunk_index_)) {
-        tuple_ = chunk_->as_tuple<Ts...>(chunk_index_);
-        return true;
+      for (chunk_index_ = chunk_->next_masked(chunk_index_, masks_);
+           chunk_index_ < chunk_->capacity();
+           chunk_index_ = chunk_->next_masked(chunk_index_ + 1, masks_)) {
+        if (resolve_row(std::index_sequence_for<Ts...>{})) return true;
       }
-      ++chunk_index_;
+      chunk_ = next_chunk();
+      chunk_index_ = 0;
+      if (chunk_) resolve_chunk();
     }
     return false;
   }
+  void resolve_chunk() {
+    if constexpr ((is_writable_v<Ts> || ...)) {
+      chunk_->detach();
+    }
+    masks_ = chunk_->row_masks<Ts...>();
+    std::size_t offsets[] = {chunk_->offset_of<sanitalize_t<Ts>>()...};
+    std::copy(std::begin(offsets), std::end(offsets), offsets_);
+  }
+  template <std::size_t... Is>
+  bool resolve_row(std::index_sequence<Is...>) {
+    tuple_ = Tuple(column<Ts>(offsets_[Is])...);
+    if constexpr ((is_sparse_v<Ts> || ...)) {
+      return tuple_.is_complete();
+    } else {
+      return true;
+    }
+  }
+  template <typename T>
+  sanitalize_t<T>* column(std::size_t offset) const {
+    using U = sanitalize_t<T>;
+    if constexpr (is_sparse_v<T>) {
+      return const_cast<U*>(
+          std::as_const(*chunk_).get_component<U>(chunk_index_, sparse_sets_));
+    } else {
+      return chunk_->at_offset<U>(chunk_index_, offset);
+    }
+  }
   Chunk* next_chunk() {
     auto chunk = chunk_;
     while (chunk) {
       chunk = chunk->next_chunk();
       if (!chunk) return nullptr;
-      if (chunk->contains<Ts...>()) return chunk;
+      if (chunk->contains(table_types_t<Ts...>{})) return chunk;
     }
     return nullptr;
   }
@@ -69,11 +108,13 @@ class Query {
 
  private:
   Chunk* chunk_ = nullptr;
+  SparseSets* sparse_sets_ = nullptr;
 
  public:
-  explicit Query(Chunk* chunk) {
+  explicit Query(Chunk* chunk, SparseSets* sparse_sets = nullptr)
+      : sparse_sets_(sparse_sets) {
     for (auto it = chunk; it && !chunk_; it = it->next_chunk()) {
-      if (it->contains<Ts...>()) {
+      if (it->contains(table_types_t<Ts...>{})) {
         chunk_ = it;
       }
     }
@@ -88,14 +129,73 @@ class Query {
   template <typename F, typename... As>
   void each(F f, type_list<As...> args) {
     for (auto chunk = chunk_; chunk; chunk = chunk->next_chunk()) {
-      if (chunk->contains<As...>()) {
-        chunk->each(f, args);
+      if (chunk->contains(table_types_t<As...>{})) {
+        chunk->each(f, args, sparse_sets_);
       }
     }
   }
 
-  QueryIterator<Ts...> begin() const { return QueryIterator<Ts...>(chunk_); }
+  // call f(chunk) for each chunk matching the query.
+  template <typename F>
+  void each_chunk(F f) const {
+    for (auto chunk = chunk_; chunk; chunk = chunk->next_chunk()) {
+      if (chunk->contains(table_types_t<Ts...>{})) {
+        f(chunk);
+      }
+    }
+  }
+
+  SparseSets* sparse_sets() const { return sparse_sets_; }
+
+  QueryIterator<Ts...> begin() const {
+    return QueryIterator<Ts...>(chunk_, sparse_sets_);
+  }
   QueryIterator<Ts...> end() const { return QueryIterator<Ts...>(); }
 };
 
+// RuntimeQuery.
+// query over types known at runtime, yielding raw column pointers.
+class RuntimeQuery {
+ private:
+  std::vector<const Type*> types_;
+  std::vector<const Type*> sorted_types_;
+  Chunk* chunk_ = nullptr;
+
+ public:
+  RuntimeQuery(Chunk* chunk, const Type* const* types, std::size_t n)
+      : types_(types, types + n), sorted_types_(types_) {
+    std::sort(sorted_types_.begin(), sorted_types_.end(), type_less);
+    for (auto it = chunk; it && !chunk_; it = it->next_chunk()) {
+      if (it->contains(sorted_types_.data(), sorted_types_.size())) {
+        chunk_ = it;
+      }
+    }
+  }
+
+  // call f(columns) for each row, where columns[k] points at the component
+  // of the k-th type. column offsets are resolved once per chunk.
+  template <typename F>
+  void each(F f) {
+    auto n = types_.size();
+    std::vector<std::size_t> offsets(n);
+    std::vector<void*> columns(n);
+    each_chunk([&](Chunk* chunk) {
+      for (std::size_t k = 0; k < n; ++k) {
+        chunk->tuple()->try_get_offset(types_[k], &offsets[k]);
+      }
+      chunk->each_raw(f, offsets.data(), n, columns.data());
+    });
+  }
+
+  // call f(chunk) for each chunk matching the query.
+  template <typename F>
+  void each_chunk(F f) const {
+    for (auto chunk = chunk_; chunk; chunk = chunk->next_chunk()) {
+      if (chunk->contains(sorted_types_.data(), sorted_types_.size())) {
+        f(chunk);
+      }
+    }
+  }
+};
+
 }  // namespace ecs
@@ -1,13 +1,29 @@
 #pragma once
-#include <deque>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "archetype.h"
 #include "chunk.h"
+#include "component.h"
 #include "entity.h"
 #include "function_traits.h"
+#include "index.h"
+#include "journal.h"
 #include "query.h"
+#include "snapshot.h"
+#include "sparse_set.h"
+#include "stats.h"
 
 namespace ecs {
 
@@ -18,40 +34,151 @@ class Registry final {
   Registry& operator=(const Registry&) = delete;
   Registry& operator=(Registry&&) = delete;
 
+ private:
+  struct JournalEntry {
+    std::unique_ptr<Journal> journal;
+    const Type* type = nullptr;
+    // null for runtime types, which are always table components.
+    const void* (*find)(const Registry*, EntityId) = nullptr;
+  };
+  struct IndexEntry {
+    std::unique_ptr<IndexBase> index;
+    const Type* type = nullptr;
+    const void* (*find)(const Registry*, EntityId) = nullptr;
+  };
+
+  // where sort_rows() by |type| resumes: the archetype, the chunk pair
+  // within it, and whether the current pass has moved anything.
+  struct SortCursor {
+    const Type* type = nullptr;
+    std::size_t archetype = 0;
+    std::size_t chunk = 0;
+    bool changed = false;
+  };
+
  private:
   std::vector<EntityStorage> entities_;
-  std::deque<std::size_t> free_indices_;
+  std::vector<std::size_t> free_indices_;
+  std::atomic<std::ptrdiff_t> free_cursor_ = 0;
   std::vector<std::unique_ptr<Archetype>> archetypes_;
   std::vector<std::unique_ptr<Chunk>> chunks_;
+  SparseSets sparse_sets_;
+  std::vector<IndexEntry> indices_;
+  std::vector<JournalEntry> removal_journals_;
+  std::unique_ptr<Journal> destruction_journal_;
   Chunk* for_iter_ = nullptr;
+  std::size_t compact_cursor_ = 0;
+  std::vector<SortCursor> sort_cursors_;
 
  public:
   Registry() = default;
-  ~Registry() { destroy_all_entities(); }
+  // rows are destructed by their chunk buffers, which may outlive this
+  // registry while shared with a fork.
+  ~Registry() = default;
 
   template <typename... Ts>
   EntityId create_entity() {
-    auto archetype = get_or_new_archetype<EntityId, Ts...>();
+    // before choosing a chunk, the flush may fill it.
+    flush_reserved_entities();
+    auto archetype = get_or_new_archetype(table_types_t<EntityId, Ts...>{});
     auto chunk = get_or_new_chunk(archetype);
     auto index = create_entity_index();
-    auto chunk_index = chunk->create();
+    auto id = bind_entity(index, chunk, chunk->create());
+    (add_sparse_component<sanitalize_t<Ts>>(index), ...);
+    update_indices(id);
+    return id;
+  }
 
-    EntityId id = {entities_[index].generation, index};
-    entities_[index].chunk = chunk;
-    entities_[index].chunk_index = chunk_index;
-    *chunk->template get<EntityId>(chunk_index) = id;
+  // thread-safe against other reserve_entity() calls, but not against
+  // structural changes. the entity is created without components at the
+  // next flush_reserved_entities() or structural change, including
+  // add_component() and remove_component(). until then is_valid() and
+  // get_component() do not see it.
+  EntityId reserve_entity() {
+    auto n = free_cursor_.fetch_sub(1, std::memory_order_relaxed);
+    if (n > 0) {
+      auto index = free_indices_[n - 1];
+      return {entities_[index].generation, index};
+    }
+    return {1, entities_.size() + static_cast<std::size_t>(-n)};
+  }
 
-    return id;
+  void flush_reserved_entities() {
+    auto cursor = free_cursor_.load(std::memory_order_acquire);
+    auto free_n = static_cast<std::ptrdiff_t>(free_indices_.size());
+    if (cursor == free_n) return;
+
+    auto archetype = get_or_new_archetype<EntityId>();
+    auto reserved_n = std::max<std::ptrdiff_t>(cursor, 0);
+    for (auto i = reserved_n; i < free_n; ++i) {
+      auto chunk = get_or_new_chunk(archetype);
+      bind_entity(free_indices_[i], chunk, chunk->create());
+    }
+    free_indices_.resize(reserved_n);
+    if (cursor < 0) {
+      auto begin = entities_.size();
+      entities_.resize(begin + static_cast<std::size_t>(-cursor));
+      for (auto i = begin; i < entities_.size(); ++i) {
+        auto chunk = get_or_new_chunk(archetype);
+        entities_[i].generation = 1;
+        bind_entity(i, chunk, chunk->create());
+      }
+    }
+    free_cursor_.store(reserved_n, std::memory_order_release);
   }
 
-  bool destroy_entity(EntityId id) {
+  // create |n| entities by copying the row of |prefab|.
+  // |f| is called for each new entity to override its components.
+  template <typename F>
+  std::vector<EntityId> instantiate(EntityId prefab, std::size_t n, F f) {
+    std::vector<EntityId> ids;
+    flush_reserved_entities();
+    if (!is_valid(prefab)) return ids;
+    auto src = entities_[prefab.index].chunk;
+    auto src_index = entities_[prefab.index].chunk_index;
+    auto archetype = find_archetype(src->tuple());
+    assert(archetype);
+
+    using args_type = typename function_traits<F>::args_type;
+    ids.reserve(n);
+    Chunk* chunk = nullptr;
+    for (std::size_t i = 0; i < n; ++i) {
+      if (!chunk || chunk->is_full()) {
+        chunk = get_or_new_chunk(archetype);
+      }
+      auto index = create_entity_index();
+      auto chunk_index = chunk->copy_from(src, src_index);
+      ids.emplace_back(bind_entity(index, chunk, chunk_index));
+      sparse_sets_.copy_all(prefab.index, index);
+      chunk->apply(chunk_index, f, args_type{});
+      update_indices(ids.back());
+    }
+    return ids;
+  }
+  std::vector<EntityId> instantiate(EntityId prefab, std::size_t n) {
+    return instantiate(prefab, n, [](EntityId) {});
+  }
+
+  bool is_valid(EntityId id) const {
     if (id.index >= entities_.size()) return false;
-    if (id.generation != entities_[id.index].generation) return false;
+    auto& storage = entities_[id.index];
+    return storage.chunk && storage.generation == id.generation;
+  }
 
+  bool destroy_entity(EntityId id) {
+    flush_reserved_entities();
+    if (!is_valid(id)) return false;
+
+    for (auto& entry : indices_) {
+      entry.index->erase(id);
+    }
+    journal_destruction(id);
     auto& storage = entities_[id.index];
     storage.chunk->destroy(storage.chunk_index);
+    sparse_sets_.remove_all(id.index);
 
     free_indices_.push_back(id.index);
+    free_cursor_.store(free_indices_.size(), std::memory_order_relaxed);
     storage.generation = std::max<size_t>(id.generation + 1, 1);
     storage.chunk = nullptr;
     storage.chunk_index = 0;
@@ -60,17 +187,489 @@ class Registry final {
   }
 
   void destroy_all_entities() {
-    for (auto& entity : entities_) {
-      if (!entity.chunk) continue;
-      entity.chunk->destroy(entity.chunk_index);
+    flush_reserved_entities();
+    if (destruction_journal_ || !removal_journals_.empty()) {
+      for (std::size_t i = 0; i < entities_.size(); ++i) {
+        if (!entities_[i].chunk) continue;
+        journal_destruction({entities_[i].generation, i});
+      }
+    }
+    for (auto& chunk : chunks_) {
+      chunk->clear();
     }
     entities_.clear();
     free_indices_.clear();
+    sparse_sets_.clear();
+    for (auto& entry : indices_) {
+      entry.index->clear();
+    }
+    free_cursor_.store(0, std::memory_order_relaxed);
+  }
+
+  // add T to |id|. sparse set components are toggled without moving the
+  // row; table components move the row to the archetype with T, and fail
+  // if the row holds a component that cannot be moved.
+  template <typename T, typename... Args>
+  T* add_component(EntityId id, Args&&... args) {
+    flush_reserved_entities();
+    if (!is_valid(id)) return nullptr;
+    if constexpr (is_sparse_v<T>) {
+      auto set = sparse_sets_.get_or_new<T>();
+      auto p = set->emplace(id.index, std::forward<Args>(args)...);
+      update_indices(id, Type::get<T>());
+      return p;
+    } else {
+      auto& storage = entities_[id.index];
+      if (!storage.chunk->template contains<T>()) {
+        auto archetype = get_or_new_archetype_with(storage.chunk->tuple(),
+                                                   Type::get<T>(), nullptr);
+        if (!move_entity(id.index, archetype)) return nullptr;
+      }
+      auto p = storage.chunk->template get<T>(storage.chunk_index);
+      if constexpr (sizeof...(Args) > 0) {
+        *p = make_component<T>(std::forward<Args>(args)...);
+      }
+      update_indices(id, Type::get<T>());
+      return p;
+    }
+  }
+
+  template <typename T>
+  bool remove_component(EntityId id) {
+    static_assert(!std::is_same_v<T, EntityId>, "EntityId is not removable.");
+    flush_reserved_entities();
+    if (!is_valid(id)) return false;
+    if constexpr (is_sparse_v<T>) {
+      auto set = sparse_sets_.find<T>();
+      if (!set || !set->remove(id.index)) return false;
+      on_component_removed(id, Type::get<T>());
+      return true;
+    } else {
+      auto& storage = entities_[id.index];
+      if (!storage.chunk->template contains<T>()) return false;
+      auto archetype = get_or_new_archetype_with(storage.chunk->tuple(),
+                                                 nullptr, Type::get<T>());
+      if (!move_entity(id.index, archetype)) return false;
+      on_component_removed(id, Type::get<T>());
+      return true;
+    }
+  }
+
+  // add T to every entity matching Qs... and return the number of entities
+  // changed. table rows are migrated a chunk at a time, looking the
+  // destination archetype up once per source chunk.
+  template <typename T, typename... Qs, typename... Args>
+  std::size_t add_component_to_query(const Args&... args) {
+    flush_reserved_entities();
+    std::size_t n = 0;
+    if constexpr (is_sparse_v<T>) {
+      auto set = sparse_sets_.get_or_new<T>();
+      each_query_row<Qs...>([&](Chunk*, std::size_t, EntityId id) {
+        set->emplace(id.index, args...);
+        update_indices(id, Type::get<T>());
+        ++n;
+      });
+    } else {
+      for (auto chunk = for_iter_; chunk;) {
+        auto next = chunk->next_chunk();
+        if (chunk->contains(table_types_t<Qs...>{}) &&
+            !chunk->template contains<T>()) {
+          auto archetype = get_or_new_archetype_with(chunk->tuple(),
+                                                     Type::get<T>(), nullptr);
+          n += migrate_query_rows<Qs...>(
+              chunk, archetype,
+              [&](Chunk* dst, std::size_t dst_index, EntityId id) {
+                if constexpr (sizeof...(Args) > 0) {
+                  *dst->template get<T>(dst_index) = make_component<T>(args...);
+                }
+                update_indices(id, Type::get<T>());
+              });
+        }
+        chunk = next;
+      }
+    }
+    return n;
+  }
+
+  // remove T from every entity matching Qs... and return the number of
+  // entities changed.
+  template <typename T, typename... Qs>
+  std::size_t remove_component_from_query() {
+    static_assert(!std::is_same_v<T, EntityId>, "EntityId is not removable.");
+    flush_reserved_entities();
+    std::size_t n = 0;
+    if constexpr (is_sparse_v<T>) {
+      auto set = sparse_sets_.find<T>();
+      if (!set) return 0;
+      each_query_row<Qs...>([&](Chunk*, std::size_t, EntityId id) {
+        if (!set->remove(id.index)) return;
+        on_component_removed(id, Type::get<T>());
+        ++n;
+      });
+    } else {
+      for (auto chunk = for_iter_; chunk;) {
+        auto next = chunk->next_chunk();
+        if (chunk->contains(table_types_t<T, Qs...>{})) {
+          auto archetype = get_or_new_archetype_with(chunk->tuple(), nullptr,
+                                                     Type::get<T>());
+          n += migrate_query_rows<Qs...>(
+              chunk, archetype, [&](Chunk*, std::size_t, EntityId id) {
+                on_component_removed(id, Type::get<T>());
+              });
+        }
+        chunk = next;
+      }
+    }
+    return n;
+  }
+
+  // runtime typed counterparts of create_entity, add/remove_component and
+  // get_component, for types made by Type::make().
+  EntityId create_entity(const Type* const* types, std::size_t n) {
+    std::vector<const Type*> sorted(types, types + n);
+    auto entity_type = Type::get<EntityId>();
+    if (std::find(sorted.begin(), sorted.end(), entity_type) == sorted.end()) {
+      sorted.emplace_back(entity_type);
+    }
+    std::sort(sorted.begin(), sorted.end(), type_less);
+    flush_reserved_entities();
+    auto archetype = get_or_new_archetype(sorted.data(), sorted.size());
+    auto chunk = get_or_new_chunk(archetype);
+    auto index = create_entity_index();
+    auto id = bind_entity(index, chunk, chunk->create());
+    update_indices(id);
+    return id;
+  }
+  void* add_component(EntityId id, const Type* type) {
+    flush_reserved_entities();
+    if (!is_valid(id)) return nullptr;
+    auto& storage = entities_[id.index];
+    if (!storage.chunk->contains(&type, 1)) {
+      auto archetype =
+          get_or_new_archetype_with(storage.chunk->tuple(), type, nullptr);
+      if (!move_entity(id.index, archetype)) return nullptr;
+      update_indices(id, type);
+    }
+    return storage.chunk->get(storage.chunk_index, type);
+  }
+  bool remove_component(EntityId id, const Type* type) {
+    assert(type != Type::get<EntityId>() && "EntityId is not removable.");
+    flush_reserved_entities();
+    if (!is_valid(id)) return false;
+    auto& storage = entities_[id.index];
+    if (!storage.chunk->contains(&type, 1)) return false;
+    auto archetype =
+        get_or_new_archetype_with(storage.chunk->tuple(), nullptr, type);
+    if (!move_entity(id.index, archetype)) return false;
+    on_component_removed(id, type);
+    return true;
+  }
+  void* get_component(EntityId id, const Type* type) {
+    if (!is_valid(id)) return nullptr;
+    auto& storage = entities_[id.index];
+    return storage.chunk->get(storage.chunk_index, type);
+  }
+
+  template <typename T>
+  T* get_component(EntityId id) {
+    if (!is_valid(id)) return nullptr;
+    auto& storage = entities_[id.index];
+    return storage.chunk->template get_component<T>(storage.chunk_index,
+                                                    &sparse_sets_);
+  }
+  // reads without detaching, e.g. a frame of RegistryHistory.
+  template <typename T>
+  const T* get_component(EntityId id) const {
+    if (!is_valid(id)) return nullptr;
+    auto& storage = entities_[id.index];
+    return std::as_const(*storage.chunk).template get_component<T>(
+        storage.chunk_index, &sparse_sets_);
+  }
+  template <typename T>
+  bool has_component(EntityId id) {
+    if (!is_valid(id)) return false;
+    auto& storage = entities_[id.index];
+    return std::as_const(*storage.chunk).template get_component<T>(
+               storage.chunk_index, &sparse_sets_) != nullptr;
+  }
+
+  // write T of |id| through |f| and reindex it.
+  // writes made through queries or get_component() are not seen by indices
+  // until reindex<T>() is called.
+  template <typename T, typename F>
+  bool patch(EntityId id, F f) {
+    auto p = get_component<T>(id);
+    if (!p) return false;
+    f(*p);
+    update_indices(id, Type::get<T>());
+    return true;
+  }
+  template <typename T>
+  void reindex(EntityId id) {
+    if (is_valid(id)) update_indices(id, Type::get<T>());
+  }
+
+  // secondary indices keyed by |f(const T&)|, kept up to date on create,
+  // destroy, add/remove_component and patch. indices are not forked.
+  template <typename T, typename F>
+  HashIndex<T, F>* add_hash_index(F f) {
+    return add_index<T>(std::make_unique<HashIndex<T, F>>(std::move(f)));
+  }
+  template <typename T, typename F>
+  OrderedIndex<T, F>* add_ordered_index(F f) {
+    return add_index<T>(std::make_unique<OrderedIndex<T, F>>(std::move(f)));
+  }
+
+  // journal of the entities that lost T, by remove_component or by being
+  // destroyed. readers keep a Journal::Cursor and read once per frame.
+  // journals are not forked.
+  template <typename T>
+  Journal* track_removals() {
+    return track_removals(Type::get<T>(), &find_component<T>);
+  }
+  Journal* track_removals(const Type* type) {
+    return track_removals(type, nullptr);
+  }
+  // journal of destroyed entities.
+  Journal* track_destructions() {
+    if (!destruction_journal_) {
+      destruction_journal_ = std::make_unique<Journal>();
+    }
+    return destruction_journal_.get();
+  }
+  // drop every journal entry, once all readers have caught up.
+  void clear_journals() {
+    for (auto& entry : removal_journals_) {
+      entry.journal->clear();
+    }
+    if (destruction_journal_) destruction_journal_->clear();
+  }
+
+  // toggle an enableable component without moving the row.
+  template <typename T>
+  bool set_enabled(EntityId id, bool enabled) {
+    if (!is_valid(id)) return false;
+    auto& storage = entities_[id.index];
+    return storage.chunk->template set_enabled<T>(storage.chunk_index,
+                                                  enabled);
+  }
+  template <typename T>
+  bool is_enabled(EntityId id) const {
+    if (!is_valid(id)) return false;
+    auto& storage = entities_[id.index];
+    return storage.chunk->template is_enabled<T>(storage.chunk_index);
+  }
+
+  RuntimeQuery query(const Type* const* types, std::size_t n) {
+    return RuntimeQuery(for_iter_, types, n);
+  }
+
+  // a registry sharing the chunk buffers of this registry copy-on-write.
+  // a chunk is copied on its first write on either side.
+  std::unique_ptr<Registry> fork() {
+    flush_reserved_entities();
+    auto registry = std::make_unique<Registry>();
+    std::unordered_map<const Chunk*, Chunk*> chunk_map;
+    chunk_map.reserve(chunks_.size());
+    registry->archetypes_.reserve(archetypes_.size());
+    registry->chunks_.reserve(chunks_.size());
+    for (auto& archetype : archetypes_) {
+      auto forked = archetype->fork();
+      Chunk* last = nullptr;
+      for (auto chunk = archetype->first_chunk(); chunk;
+           chunk = chunk->next_same_archetype_chunk()) {
+        auto p = registry->chunks_.emplace_back(chunk->fork()).get();
+        if (last) {
+          last->link_same_archetype_chunk(p);
+        } else {
+          forked->link_chunk(p);
+        }
+        chunk_map.emplace(chunk, p);
+        last = p;
+      }
+      registry->archetypes_.emplace_back(std::move(forked));
+    }
+    Chunk* last = nullptr;
+    for (auto chunk = for_iter_; chunk; chunk = chunk->next_chunk()) {
+      auto p = chunk_map[chunk];
+      if (last) {
+        last->link_chunk(p);
+      } else {
+        registry->for_iter_ = p;
+      }
+      last = p;
+    }
+
+    registry->entities_ = entities_;
+    for (auto& entity : registry->entities_) {
+      if (entity.chunk) entity.chunk = chunk_map[entity.chunk];
+    }
+    registry->free_indices_ = free_indices_;
+    registry->free_cursor_.store(free_cursor_.load(std::memory_order_relaxed),
+                                 std::memory_order_relaxed);
+    registry->sparse_sets_.copy_from(sparse_sets_);
+    registry->compact_cursor_ = compact_cursor_;
+    registry->sort_cursors_ = sort_cursors_;
+    return registry;
+  }
+
+  // append the changes since |baseline| to |out| for the types of |schema|:
+  // destroyed entities, spawned or moved entities with all of their
+  // columns, and the changed columns of the others. |baseline| is meant to
+  // be a fork taken at the previous snapshot, so that chunks still sharing
+  // its buffers are skipped without comparing. null writes every entity.
+  void write_delta(const Registry* baseline, const SnapshotSchema& schema,
+                   std::vector<std::uint8_t>* out) {
+    flush_reserved_entities();
+    DeltaWriter writer(out, schema);
+    std::unordered_set<const void*> shared;
+    if (baseline) {
+      shared.reserve(baseline->chunks_.size());
+      for (auto& chunk : baseline->chunks_) {
+        shared.emplace(chunk->buffer());
+      }
+      for (std::size_t i = 0; i < baseline->entities_.size(); ++i) {
+        auto& storage = baseline->entities_[i];
+        if (!storage.chunk) continue;
+        EntityId id = {storage.generation, i};
+        if (!is_valid(id)) writer.record(DeltaRecord::Destroy, id);
+      }
+    }
+
+    std::vector<std::uint32_t> columns;
+    for (auto& chunk : chunks_) {
+      if (chunk->count() == 0 || shared.count(chunk->buffer())) continue;
+      const Chunk* c = chunk.get();
+      columns.clear();
+      for (std::size_t i = 0; i < c->tuple()->type_size(); ++i) {
+        auto type_index = schema.index_of(c->tuple()->type(i));
+        if (type_index != SnapshotSchema::NPOS) {
+          columns.emplace_back(type_index);
+        }
+      }
+      std::sort(columns.begin(), columns.end());
+      for (auto i = c->next_use(0); i < c->capacity(); i = c->next_use(i + 1)) {
+        auto id = *c->get<EntityId>(i);
+        const Chunk* base = nullptr;
+        std::size_t base_index = 0;
+        if (baseline && baseline->is_valid(id)) {
+          base = baseline->entities_[id.index].chunk;
+          base_index = baseline->entities_[id.index].chunk_index;
+        }
+        if (!base || !is_same_types(base->tuple(), c->tuple())) {
+          write_spawn(&writer, schema, columns, id, c, i);
+        } else {
+          write_update(&writer, schema, columns, id, c, i, base, base_index);
+        }
+      }
+    }
+    // free indices past the baseline, from the last one, so that the reader
+    // grows its table to this one.
+    auto begin = baseline ? baseline->entities_.size() : 0;
+    for (auto i = entities_.size(); i-- > begin;) {
+      if (!entities_[i].chunk) {
+        writer.record(DeltaRecord::Destroy, {entities_[i].generation, i});
+      }
+    }
+    writer.record(DeltaRecord::End);
+  }
+
+  // apply a delta written by write_delta() with the same schema.
+  // returns false if the stream is malformed; records before the error
+  // stay applied.
+  bool apply_delta(const std::uint8_t* data, std::size_t size,
+                   const SnapshotSchema& schema) {
+    flush_reserved_entities();
+    DeltaReader reader(data, size);
+    if (!reader.read_header(schema)) return false;
+    std::vector<const Type*> types;
+    while (true) {
+      DeltaRecord kind = DeltaRecord::End;
+      if (!reader.read(&kind)) return false;
+      if (kind == DeltaRecord::End) return true;
+      EntityId id;
+      if (!reader.read_id(&id)) return false;
+      switch (kind) {
+        case DeltaRecord::Destroy:
+          if (!read_destroy(reader, id)) return false;
+          break;
+        case DeltaRecord::Spawn:
+          if (!read_spawn(&reader, schema, id, &types)) return false;
+          break;
+        case DeltaRecord::Update:
+          if (!read_update(&reader, schema, id)) return false;
+          break;
+        default:
+          return false;
+      }
+    }
   }
 
   template <typename... Ts>
   Query<Ts...> query() {
-    return Query<Ts...>(for_iter_);
+    return Query<Ts...>(for_iter_, &sparse_sets_);
+  }
+
+  // move rows out of sparse chunks into dense ones and free emptied chunks.
+  // archetypes with a component that cannot be moved are left as they are.
+  // must not be called while a query is iterating.
+  // returns true when every archetype is compacted within |budget|.
+  bool compact(std::chrono::microseconds budget) {
+    using clock = std::chrono::steady_clock;
+    auto deadline = clock::now() + budget;
+    for (std::size_t i = 0, n = archetypes_.size(); i < n; ++i) {
+      auto archetype = archetypes_[compact_cursor_ % n].get();
+      if (!compact_archetype(archetype, deadline)) return false;
+      compact_cursor_ = (compact_cursor_ + 1) % n;
+    }
+    return true;
+  }
+
+  // order the rows of each archetype with T by |key(const T&)|, e.g. the
+  // morton_code() of a position, so that iteration visits close keys
+  // together. sorting is incremental: adjacent chunks are merged a pair at
+  // a time until |budget| runs out. must not be called while a query is
+  // iterating. returns true when every archetype with T is sorted.
+  template <typename T, typename F>
+  bool sort_rows(F key, std::chrono::microseconds budget) {
+    static_assert(!is_sparse_v<T>, "rows are sorted by a table component.");
+    using clock = std::chrono::steady_clock;
+    auto deadline = clock::now() + budget;
+    auto& cursor = sort_cursor(Type::get<T>());
+    for (std::size_t i = 0, n = archetypes_.size(); i < n; ++i) {
+      auto archetype = archetypes_[cursor.archetype % n].get();
+      if (archetype->tuple()->template contains<T>() &&
+          archetype->tuple()->is_movable() &&
+          !sort_archetype<T>(archetype, key, &cursor, deadline)) {
+        return false;
+      }
+      cursor = {cursor.type, (cursor.archetype + 1) % n, 0, false};
+    }
+    return true;
+  }
+
+  RegistryStats stats() const {
+    RegistryStats stats;
+    stats.archetypes.reserve(archetypes_.size());
+    for (auto& archetype : archetypes_) {
+      auto a = archetype->stats();
+      stats.chunk_count += a.chunk_count;
+      stats.capacity += a.capacity;
+      stats.live_rows += a.live_rows;
+      stats.padding_size += a.row_padding * a.live_rows;
+      stats.memory_size += a.memory_size;
+      stats.archetypes.emplace_back(a);
+    }
+    stats.archetype_count = archetypes_.size();
+    // reserved entities count as live before they are flushed.
+    auto cursor = free_cursor_.load(std::memory_order_relaxed);
+    stats.entity_count = static_cast<std::size_t>(
+        static_cast<std::ptrdiff_t>(entities_.size()) - cursor);
+    stats.free_index_count =
+        static_cast<std::size_t>(std::max<std::ptrdiff_t>(cursor, 0));
+    stats.memory_size += entities_.capacity() * sizeof(EntityStorage) +
+                         free_indices_.size() * sizeof(std::size_t);
+    return stats;
   }
 
  private:
@@ -86,12 +685,203 @@ class Registry final {
     archetypes_.emplace_back(std::move(archetype));
     return p;
   }
+  template <typename... Ts>
+  Archetype* get_or_new_archetype(type_list<Ts...>) {
+    return get_or_new_archetype<Ts...>();
+  }
+  // |types| must be sorted by type_less.
+  Archetype* get_or_new_archetype(const Type* const* types, std::size_t n) {
+    for (auto& archetype : archetypes_) {
+      if (archetype->is_match(types, n)) {
+        return archetype.get();
+      }
+    }
+    auto archetype = Archetype::make(types, n);
+    auto p = archetype.get();
+    archetypes_.emplace_back(std::move(archetype));
+    return p;
+  }
+  // archetype of |tuple| with |add| added and |remove| removed.
+  Archetype* get_or_new_archetype_with(const Tuple* tuple, const Type* add,
+                                       const Type* remove) {
+    std::vector<const Type*> types;
+    types.reserve(tuple->type_size() + 1);
+    for (std::size_t i = 0; i < tuple->type_size(); ++i) {
+      if (tuple->type(i) != remove) {
+        types.emplace_back(tuple->type(i));
+      }
+    }
+    if (add) {
+      types.emplace_back(add);
+    }
+    std::sort(types.begin(), types.end(), type_less);
+    return get_or_new_archetype(types.data(), types.size());
+  }
+
+  // returns false, leaving the row in place, if it cannot be moved.
+  bool move_entity(std::size_t index, Archetype* archetype) {
+    auto& storage = entities_[index];
+    if (!archetype->tuple()->can_migrate_from(storage.chunk->tuple())) {
+      return false;
+    }
+    auto chunk = get_or_new_chunk(archetype);
+    storage.chunk_index =
+        chunk->migrate_from(storage.chunk, storage.chunk_index);
+    storage.chunk = chunk;
+    return true;
+  }
+
+  // call f(chunk, chunk_index, id) for each row matching Qs...
+  template <typename... Qs, typename F>
+  void each_query_row(F f) {
+    for (auto chunk = for_iter_; chunk; chunk = chunk->next_chunk()) {
+      if (!chunk->contains(table_types_t<Qs...>{})) continue;
+      for (auto i = chunk->next_use(0); i < chunk->capacity();
+           i = chunk->next_use(i + 1)) {
+        if (!is_query_row<Qs...>(chunk, i)) continue;
+        f(chunk, i, *std::as_const(*chunk).template get<EntityId>(i));
+      }
+    }
+  }
+
+  // migrate the rows of |src| matching Qs... into |archetype|, calling
+  // f(dst, dst_index, id) for each, and release |src| once it is empty.
+  // when every row moves and no chunk of |archetype| has room for them,
+  // |src| itself is handed over; only rows past its capacity for
+  // |archetype| move one at a time. rows that cannot be moved are skipped.
+  template <typename... Qs, typename F>
+  std::size_t migrate_query_rows(Chunk* src, Archetype* archetype, F f) {
+    if (!archetype->tuple()->can_migrate_from(src->tuple())) return 0;
+    auto free_chunk = archetype->get_free_chunk();
+    auto hand_off =
+        src->count() != 0 &&
+        (!free_chunk ||
+         free_chunk->capacity() - free_chunk->count() < src->count()) &&
+        is_query_chunk<Qs...>(src);
+    auto begin = hand_off ? Chunk::capacity_of(*archetype->tuple()) : 0;
+
+    std::size_t n = 0;
+    Chunk* dst = nullptr;
+    for (auto i = src->next_use(begin); i < src->capacity();
+         i = src->next_use(i + 1)) {
+      if (!is_query_row<Qs...>(src, i)) continue;
+      if (!dst || dst->is_full()) {
+        dst = get_or_new_chunk(archetype);
+      }
+      auto id = *std::as_const(*src).template get<EntityId>(i);
+      auto& storage = entities_[id.index];
+      storage.chunk_index = dst->migrate_from(src, i);
+      storage.chunk = dst;
+      f(dst, storage.chunk_index, id);
+      ++n;
+    }
+    if (hand_off && src->count() != 0) {
+      find_archetype(src->tuple())->unlink_chunk(src);
+      src->link_same_archetype_chunk(nullptr);
+      src->migrate_all(archetype->shared_tuple());
+      archetype->link_chunk(src);
+      src->each_index([&](std::size_t i) {
+        f(src, i, *std::as_const(*src).template get<EntityId>(i));
+        ++n;
+      });
+      return n;
+    }
+    if (src->count() == 0) {
+      release_chunk(find_archetype(src->tuple()), src);
+    }
+    return n;
+  }
+
+  template <typename... Qs>
+  bool is_query_chunk(const Chunk* chunk) const {
+    for (auto i = chunk->next_use(0); i < chunk->capacity();
+         i = chunk->next_use(i + 1)) {
+      if (!is_query_row<Qs...>(chunk, i)) return false;
+    }
+    return true;
+  }
+  template <typename... Qs>
+  bool is_query_row(const Chunk* chunk, std::size_t index) const {
+    return chunk->template are_enabled<Qs...>(index) &&
+           chunk->template has_components<Qs...>(index, &sparse_sets_);
+  }
+
+  template <typename T>
+  void add_sparse_component(std::size_t index) {
+    if constexpr (is_sparse_v<T>) {
+      sparse_sets_.get_or_new<T>()->emplace(index);
+    }
+  }
+
+  Archetype* find_archetype(const Tuple* tuple) const {
+    for (auto& archetype : archetypes_) {
+      if (archetype->tuple() == tuple) return archetype.get();
+    }
+    return nullptr;
+  }
+
+  template <typename T>
+  static const void* find_component(const Registry* registry, EntityId id) {
+    auto& storage = registry->entities_[id.index];
+    return static_cast<const Chunk*>(storage.chunk)
+        ->template get_component<T>(storage.chunk_index,
+                                    &registry->sparse_sets_);
+  }
+
+  template <typename T, typename Index>
+  Index* add_index(std::unique_ptr<Index> index) {
+    flush_reserved_entities();
+    auto p = index.get();
+    for (std::size_t i = 0; i < entities_.size(); ++i) {
+      if (!entities_[i].chunk) continue;
+      EntityId id = {entities_[i].generation, i};
+      p->update(id, find_component<T>(this, id));
+    }
+    indices_.push_back({std::move(index), Type::get<T>(), &find_component<T>});
+    return p;
+  }
+
+  Journal* track_removals(const Type* type,
+                          const void* (*find)(const Registry*, EntityId)) {
+    for (auto& entry : removal_journals_) {
+      if (entry.type == type) return entry.journal.get();
+    }
+    return removal_journals_
+        .emplace_back(JournalEntry{std::make_unique<Journal>(), type, find})
+        .journal.get();
+  }
+
+  void on_component_removed(EntityId id, const Type* type) {
+    update_indices(id, type);
+    for (auto& entry : removal_journals_) {
+      if (entry.type == type) entry.journal->push(id);
+    }
+  }
+  // called before |id| is destroyed, while its components are still there.
+  void journal_destruction(EntityId id) {
+    if (destruction_journal_) destruction_journal_->push(id);
+    const Chunk* chunk = entities_[id.index].chunk;
+    auto chunk_index = entities_[id.index].chunk_index;
+    for (auto& entry : removal_journals_) {
+      auto p = entry.find ? entry.find(this, id)
+                          : chunk->get(chunk_index, entry.type);
+      if (p) entry.journal->push(id);
+    }
+  }
+
+  // reindex |id| in every index, or in the indices of |type| only.
+  void update_indices(EntityId id, const Type* type = nullptr) {
+    for (auto& entry : indices_) {
+      if (type && entry.type != type) continue;
+      entry.index->update(id, entry.find(this, id));
+    }
+  }
 
   Chunk* get_or_new_chunk(Archetype* archetype) {
     if (auto chunk = archetype->get_free_chunk()) {
       return chunk;
     }
-    std::unique_ptr<Chunk> chunk(new Chunk(archetype->tuple()));
+    auto chunk = std::make_unique<Chunk>(archetype->shared_tuple());
     auto p = chunk.get();
     chunks_.emplace_back(std::move(chunk));
     link_chunk(p);
@@ -99,18 +889,299 @@ class Registry final {
     return p;
   }
 
+  template <typename TimePoint>
+  bool compact_archetype(Archetype* archetype, TimePoint deadline) {
+    if (!archetype->tuple()->is_movable()) return true;
+    while (auto src = archetype->get_sparse_chunk()) {
+      if (src->count() == 0) {
+        release_chunk(archetype, src);
+        continue;
+      }
+      auto dst = archetype->get_free_chunk(src);
+      if (!dst) break;
+      for (auto i = src->next_use(0); i < src->capacity() && !dst->is_full();
+           i = src->next_use(i + 1)) {
+        if (TimePoint::clock::now() >= deadline) return false;
+        auto index = src->get<EntityId>(i)->index;
+        entities_[index].chunk = dst;
+        entities_[index].chunk_index = dst->move_from(src, i);
+      }
+    }
+    return true;
+  }
+
+  SortCursor& sort_cursor(const Type* type) {
+    for (auto& cursor : sort_cursors_) {
+      if (cursor.type == type) return cursor;
+    }
+    return sort_cursors_.emplace_back(SortCursor{type});
+  }
+
+  // passes over the adjacent chunk pairs of |archetype| until one changes
+  // nothing, resuming from |*cursor|.
+  template <typename T, typename F, typename TimePoint>
+  bool sort_archetype(Archetype* archetype, F& key, SortCursor* cursor,
+                      TimePoint deadline) {
+    while (true) {
+      auto a = archetype->first_chunk();
+      for (std::size_t i = 0; a && i < cursor->chunk; ++i) {
+        a = a->next_same_archetype_chunk();
+      }
+      while (a) {
+        // skip empty chunks, which would split the sorted run in two.
+        auto b = a->next_same_archetype_chunk();
+        auto b_position = cursor->chunk + 1;
+        while (b && b->count() == 0) {
+          b = b->next_same_archetype_chunk();
+          ++b_position;
+        }
+        cursor->changed |= sort_chunk_pair<T>(archetype, a, b, key);
+        if (!b) break;
+        // when every row of |b| went to |a|, |a| goes on with the next
+        // chunk.
+        if (b->count() != 0) {
+          a = b;
+          cursor->chunk = b_position;
+        }
+        if (TimePoint::clock::now() >= deadline) return false;
+      }
+      if (!cursor->changed) return true;
+      cursor->chunk = 0;
+      cursor->changed = false;
+      if (TimePoint::clock::now() >= deadline) return false;
+    }
+  }
+
+  // move the rows of |a| and |b| so that iterating |a| then |b| yields
+  // them ordered by key. |b| may be null to sort |a| alone.
+  // returns false if they were in order already.
+  template <typename T, typename F>
+  bool sort_chunk_pair(Archetype* archetype, Chunk* a, Chunk* b, F& key) {
+    using key_type = std::decay_t<std::invoke_result_t<F&, const T&>>;
+    struct Row {
+      key_type key;
+      Chunk* chunk;
+      std::size_t index;
+    };
+    std::vector<Row> rows;
+    rows.reserve(a->count() + (b ? b->count() : 0));
+    for (auto chunk : {a, b}) {
+      if (!chunk) continue;
+      for (auto i = chunk->next_use(0); i < chunk->capacity();
+           i = chunk->next_use(i + 1)) {
+        rows.push_back({key(*std::as_const(*chunk).template get<T>(i)),
+                        chunk, i});
+      }
+    }
+    auto less = [](const Row& lhs, const Row& rhs) {
+      return lhs.key < rhs.key;
+    };
+    if (std::is_sorted(rows.begin(), rows.end(), less)) return false;
+    std::stable_sort(rows.begin(), rows.end(), less);
+
+    // the rows go to the scratch chunks, whose buffers are swapped in. the
+    // emptied buffers of |a| and |b| are the scratch of the next pair.
+    auto sorted_a = archetype->scratch_chunk(0);
+    auto sorted_b = archetype->scratch_chunk(1);
+    auto dst = sorted_a;
+    for (auto& row : rows) {
+      if (dst->is_full()) dst = sorted_b;
+      dst->move_from(row.chunk, row.index);
+    }
+    a->swap(sorted_a);
+    if (b) b->swap(sorted_b);
+    for (auto chunk : {a, b}) {
+      if (!chunk) continue;
+      for (auto i = chunk->next_use(0); i < chunk->capacity();
+           i = chunk->next_use(i + 1)) {
+        auto& storage = entities_[chunk->template get<EntityId>(i)->index];
+        storage.chunk = chunk;
+        storage.chunk_index = i;
+      }
+    }
+    return true;
+  }
+
+  static bool is_same_types(const Tuple* lhs, const Tuple* rhs) {
+    if (lhs == rhs) return true;
+    if (lhs->type_size() != rhs->type_size()) return false;
+    for (std::size_t i = 0; i < lhs->type_size(); ++i) {
+      if (lhs->type(i) != rhs->type(i)) return false;
+    }
+    return true;
+  }
+
+  static void write_spawn(DeltaWriter* writer, const SnapshotSchema& schema,
+                          const std::vector<std::uint32_t>& columns,
+                          EntityId id, const Chunk* chunk, std::size_t index) {
+    writer->record(DeltaRecord::Spawn, id);
+    writer->write(static_cast<std::uint32_t>(columns.size()));
+    for (auto column : columns) {
+      writer->write(column);
+    }
+    for (auto column : columns) {
+      auto type = schema.type(column);
+      writer->write_bytes(chunk->get(index, type), type->size);
+    }
+  }
+  static void write_update(DeltaWriter* writer, const SnapshotSchema& schema,
+                           const std::vector<std::uint32_t>& columns,
+                           EntityId id, const Chunk* chunk, std::size_t index,
+                           const Chunk* base, std::size_t base_index) {
+    std::size_t count_offset = 0;
+    std::uint32_t n = 0;
+    for (auto column : columns) {
+      auto type = schema.type(column);
+      auto p = chunk->get(index, type);
+      if (std::memcmp(p, base->get(base_index, type), type->size) == 0) {
+        continue;
+      }
+      if (n++ == 0) {
+        writer->record(DeltaRecord::Update, id);
+        count_offset = writer->skip(sizeof(std::uint32_t));
+      }
+      writer->write(column);
+      writer->write_bytes(p, type->size);
+    }
+    if (n != 0) writer->write_at(count_offset, n);
+  }
+
+  bool read_spawn(DeltaReader* reader, const SnapshotSchema& schema,
+                  EntityId id, std::vector<const Type*>* types) {
+    std::uint32_t n = 0;
+    if (!reader->read(&n) || n > schema.size()) return false;
+    types->clear();
+    for (std::uint32_t i = 0; i < n; ++i) {
+      std::uint32_t column = 0;
+      if (!reader->read(&column) || column >= schema.size()) return false;
+      types->emplace_back(schema.type(column));
+    }
+    std::vector<const Type*> sorted(*types);
+    sorted.emplace_back(Type::get<EntityId>());
+    std::sort(sorted.begin(), sorted.end(), type_less);
+    auto archetype = get_or_new_archetype(sorted.data(), sorted.size());
+
+    if (is_valid(id)) {
+      auto tuple = entities_[id.index].chunk->tuple();
+      if (tuple != archetype->tuple()) {
+        if (!move_entity(id.index, archetype)) return false;
+        // the types the spawn lacks are removed, as by remove_component().
+        for (std::size_t i = 0; i < tuple->type_size(); ++i) {
+          auto type = tuple->type(i);
+          if (!archetype->tuple()->contains(&type, 1)) {
+            on_component_removed(id, type);
+          }
+        }
+      }
+    } else {
+      if (!can_grow_to(*reader, id.index)) return false;
+      if (id.index < entities_.size() && entities_[id.index].chunk) {
+        destroy_entity({entities_[id.index].generation, id.index});
+      }
+      claim_entity_index(id.index);
+      entities_[id.index].generation = id.generation;
+      auto chunk = get_or_new_chunk(archetype);
+      bind_entity(id.index, chunk, chunk->create());
+    }
+    auto& storage = entities_[id.index];
+    for (auto type : *types) {
+      auto p = reader->read_bytes(type->size);
+      if (!p) return false;
+      std::memcpy(storage.chunk->get(storage.chunk_index, type), p,
+                  type->size);
+    }
+    update_indices(id);
+    return true;
+  }
+  // a destroyed entity, or a free index past the end of the table.
+  bool read_destroy(const DeltaReader& reader, EntityId id) {
+    if (id.index < entities_.size()) {
+      destroy_entity(id);
+      return true;
+    }
+    if (!can_grow_to(reader, id.index)) return false;
+    grow_entity_table(id.index + 1);
+    entities_[id.index].generation = id.generation;
+    return true;
+  }
+  // every index the table would grow over has a record left, since the
+  // writer lists free indices too. this keeps a malformed index from
+  // growing the table without bound.
+  bool can_grow_to(const DeltaReader& reader, std::size_t index) const {
+    return index < entities_.size() ||
+           index - entities_.size() <= reader.max_record_count();
+  }
+  bool read_update(DeltaReader* reader, const SnapshotSchema& schema,
+                   EntityId id) {
+    std::uint32_t n = 0;
+    if (!reader->read(&n)) return false;
+    for (std::uint32_t i = 0; i < n; ++i) {
+      std::uint32_t column = 0;
+      if (!reader->read(&column) || column >= schema.size()) return false;
+      auto type = schema.type(column);
+      auto p = reader->read_bytes(type->size);
+      if (!p) return false;
+      auto dst = get_component(id, type);
+      if (!dst) continue;
+      std::memcpy(dst, p, type->size);
+      update_indices(id, type);
+    }
+    return true;
+  }
+
+  // take |index| off the free list, growing the entity table to it.
+  void claim_entity_index(std::size_t index) {
+    if (index >= entities_.size()) grow_entity_table(index + 1);
+    auto it = std::find(free_indices_.begin(), free_indices_.end(), index);
+    if (it != free_indices_.end()) free_indices_.erase(it);
+    free_cursor_.store(free_indices_.size(), std::memory_order_relaxed);
+  }
+  // grow the entity table to |n| slots, the new ones free.
+  void grow_entity_table(std::size_t n) {
+    auto begin = entities_.size();
+    entities_.resize(n);
+    // generation 0 is the invalid id.
+    for (auto i = begin; i < n; ++i) {
+      entities_[i].generation = 1;
+      free_indices_.emplace_back(i);
+    }
+    free_cursor_.store(free_indices_.size(), std::memory_order_relaxed);
+  }
+
+  void release_chunk(Archetype* archetype, Chunk* chunk) {
+    archetype->unlink_chunk(chunk);
+    unlink_chunk(chunk);
+    auto it = std::find_if(chunks_.begin(), chunks_.end(),
+                           [chunk](auto& p) { return p.get() == chunk; });
+    assert(it != chunks_.end());
+    chunks_.erase(it);
+  }
+
+  // freed indices are reused last in, first out, the order reserve_entity()
+  // pops them in.
   std::size_t create_entity_index() {
+    flush_reserved_entities();
     size_t index = 0;
     if (free_indices_.empty()) {
       index = entities_.size();
       entities_.emplace_back().generation = 1;
     } else {
-      index = free_indices_.front();
-      free_indices_.pop_front();
+      index = free_indices_.back();
+      free_indices_.pop_back();
+      free_cursor_.store(free_indices_.size(), std::memory_order_relaxed);
     }
     return index;
   }
 
+  EntityId bind_entity(std::size_t index, Chunk* chunk,
+                       std::size_t chunk_index) {
+    EntityId id = {entities_[index].generation, index};
+    entities_[index].chunk = chunk;
+    entities_[index].chunk_index = chunk_index;
+    *chunk->template get<EntityId>(chunk_index) = id;
+    return id;
+  }
+
   void link_chunk(Chunk* chunk) {
     for (auto it = for_iter_; it; it = it->next_chunk()) {
       if (it->next_chunk()) continue;
@@ -119,6 +1190,17 @@ class Registry final {
     }
     for_iter_ = chunk;
   }
+  void unlink_chunk(Chunk* chunk) {
+    if (for_iter_ == chunk) {
+      for_iter_ = chunk->next_chunk();
+      return;
+    }
+    for (auto it = for_iter_; it; it = it->next_chunk()) {
+      if (it->next_chunk() != chunk) continue;
+      it->link_chunk(chunk->next_chunk());
+      return;
+    }
+  }
 };
 
 }  // namespace ecs
@@ -0,0 +1,167 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "entity.h"
+#include "type.h"
+
+namespace ecs {
+
+// SnapshotSchema.
+// the replicated types, in an order both sides agree on. a type is
+// encoded by its index in the schema, since Type pointers differ between
+// processes. columns are copied as raw bytes, so types must be trivially
+// copyable. sparse set components are not serialized.
+class SnapshotSchema {
+ public:
+  static constexpr std::uint32_t NPOS = static_cast<std::uint32_t>(-1);
+
+ private:
+  std::vector<const Type*> types_;
+
+ public:
+  template <typename T>
+  SnapshotSchema& add() {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "snapshot types must be trivially copyable.");
+    static_assert(!is_sparse_v<T>,
+                  "snapshot types must be table components.");
+    return add(Type::get<T>());
+  }
+  SnapshotSchema& add(const Type* type) {
+    assert(type->is_trivially_copyable &&
+           "snapshot types must be trivially copyable.");
+    types_.emplace_back(type);
+    return *this;
+  }
+
+  std::uint32_t index_of(const Type* type) const {
+    for (std::size_t i = 0; i < types_.size(); ++i) {
+      if (types_[i] == type) return static_cast<std::uint32_t>(i);
+    }
+    return NPOS;
+  }
+  const Type* type(std::size_t i) const { return types_[i]; }
+  std::size_t size() const { return types_.size(); }
+};
+
+// delta stream layout, in host byte order:
+//   header: MAGIC, VERSION, schema size (u32 each)
+//   Destroy: u8 kind, u64 generation, u64 index
+//   Spawn:   u8 kind, u64 generation, u64 index, u32 n, n * u32 type,
+//            then the bytes of each column in the same order
+//   Update:  u8 kind, u64 generation, u64 index, u32 n,
+//            n * (u32 type, column bytes)
+//   End:     u8 kind
+// Destroy records also list the free indices past the baseline's entity
+// table, the last first, so that the reader's table grows to the writer's
+// and never over more indices than there are records left.
+enum class DeltaRecord : std::uint8_t {
+  End,
+  Destroy,
+  Spawn,
+  Update,
+};
+
+// DeltaWriter.
+class DeltaWriter {
+ public:
+  static constexpr std::uint32_t MAGIC = 0x544c4445;  // "EDLT"
+  static constexpr std::uint32_t VERSION = 1;
+
+ private:
+  std::vector<std::uint8_t>* out_ = nullptr;
+
+ public:
+  DeltaWriter(std::vector<std::uint8_t>* out, const SnapshotSchema& schema)
+      : out_(out) {
+    write(MAGIC);
+    write(VERSION);
+    write(static_cast<std::uint32_t>(schema.size()));
+  }
+
+  void record(DeltaRecord kind) { write(kind); }
+  void record(DeltaRecord kind, EntityId id) {
+    write(kind);
+    write(static_cast<std::uint64_t>(id.generation));
+    write(static_cast<std::uint64_t>(id.index));
+  }
+
+  template <typename T>
+  void write(const T& value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    write_bytes(&value, sizeof(T));
+  }
+  void write_bytes(const void* p, std::size_t n) {
+    auto bytes = static_cast<const std::uint8_t*>(p);
+    out_->insert(out_->end(), bytes, bytes + n);
+  }
+  // reserve |n| bytes to be filled later, e.g. a count.
+  std::size_t skip(std::size_t n) {
+    auto offset = out_->size();
+    out_->resize(offset + n);
+    return offset;
+  }
+  template <typename T>
+  void write_at(std::size_t offset, const T& value) {
+    std::memcpy(out_->data() + offset, &value, sizeof(T));
+  }
+};
+
+// DeltaReader.
+// every read fails once the stream is exhausted or malformed.
+class DeltaReader {
+ public:
+  // kind, generation and index.
+  static constexpr std::size_t MIN_RECORD_SIZE =
+      sizeof(DeltaRecord) + 2 * sizeof(std::uint64_t);
+
+ private:
+  const std::uint8_t* p_ = nullptr;
+  const std::uint8_t* end_ = nullptr;
+
+ public:
+  DeltaReader(const std::uint8_t* data, std::size_t size)
+      : p_(data), end_(data + size) {}
+
+  bool read_header(const SnapshotSchema& schema) {
+    std::uint32_t magic = 0, version = 0, type_n = 0;
+    return read(&magic) && magic == DeltaWriter::MAGIC && read(&version) &&
+           version == DeltaWriter::VERSION && read(&type_n) &&
+           type_n == schema.size();
+  }
+  bool read_id(EntityId* id) {
+    std::uint64_t generation = 0, index = 0;
+    if (!read(&generation) || !read(&index)) return false;
+    id->generation = static_cast<std::size_t>(generation);
+    id->index = static_cast<std::size_t>(index);
+    return true;
+  }
+
+  template <typename T>
+  bool read(T* value) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    auto p = read_bytes(sizeof(T));
+    if (!p) return false;
+    std::memcpy(value, p, sizeof(T));
+    return true;
+  }
+  // an upper bound of the records left.
+  std::size_t max_record_count() const {
+    return static_cast<std::size_t>(end_ - p_) / MIN_RECORD_SIZE;
+  }
+
+  // the next |n| bytes, or nullptr.
+  const std::uint8_t* read_bytes(std::size_t n) {
+    if (static_cast<std::size_t>(end_ - p_) < n) return nullptr;
+    auto p = p_;
+    p_ += n;
+    return p;
+  }
+};
+
+}  // namespace ecs
@@ -0,0 +1,214 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "component.h"
+
+namespace ecs {
+
+class SparseSetBase {
+ public:
+  virtual ~SparseSetBase() = default;
+
+  virtual bool contains(std::size_t index) const = 0;
+  virtual bool copy(std::size_t src_index, std::size_t dst_index) = 0;
+  virtual bool remove(std::size_t index) = 0;
+  virtual void clear() = 0;
+  virtual std::unique_ptr<SparseSetBase> clone() const = 0;
+};
+
+// SparseSet.
+// components keyed by entity index, stored densely outside of archetypes.
+template <typename T>
+class SparseSet final : public SparseSetBase {
+ private:
+  static constexpr std::size_t PAGE_SIZE = 1024;
+
+ private:
+  // dense index + 1 for each entity index, 0 if none.
+  std::vector<std::unique_ptr<std::size_t[]>> pages_;
+  std::vector<std::size_t> indices_;
+  std::vector<T> values_;
+
+ public:
+  template <typename... Args>
+  T* emplace(std::size_t index, Args&&... args) {
+    auto& slot = get_or_new_slot(index);
+    if (slot != 0) {
+      if constexpr (sizeof...(Args) > 0) {
+        values_[slot - 1] = make_component<T>(std::forward<Args>(args)...);
+      }
+      return &values_[slot - 1];
+    }
+    indices_.emplace_back(index);
+    values_.emplace_back(make_component<T>(std::forward<Args>(args)...));
+    slot = values_.size();
+    return &values_.back();
+  }
+
+  T* find(std::size_t index) {
+    auto slot = find_slot(index);
+    return slot != 0 ? &values_[slot - 1] : nullptr;
+  }
+
+  virtual bool contains(std::size_t index) const override {
+    return find_slot(index) != 0;
+  }
+  virtual bool copy(std::size_t src_index, std::size_t dst_index) override {
+    if constexpr (std::is_copy_constructible_v<T>) {
+      auto slot = find_slot(src_index);
+      if (slot == 0) return false;
+      T x = values_[slot - 1];
+      emplace(dst_index, std::move(x));
+      return true;
+    } else {
+      assert(false && "type is not copy constructible.");
+      return false;
+    }
+  }
+  virtual bool remove(std::size_t index) override {
+    auto slot = find_slot(index);
+    if (slot == 0) return false;
+    auto last = values_.size();
+    if (slot != last) {
+      values_[slot - 1] = std::move(values_.back());
+      indices_[slot - 1] = indices_.back();
+      get_or_new_slot(indices_[slot - 1]) = slot;
+    }
+    values_.pop_back();
+    indices_.pop_back();
+    get_or_new_slot(index) = 0;
+    return true;
+  }
+  virtual void clear() override {
+    pages_.clear();
+    indices_.clear();
+    values_.clear();
+  }
+  virtual std::unique_ptr<SparseSetBase> clone() const override {
+    if constexpr (std::is_copy_constructible_v<T>) {
+      auto set = std::make_unique<SparseSet<T>>();
+      set->pages_.resize(pages_.size());
+      for (std::size_t i = 0; i < pages_.size(); ++i) {
+        if (!pages_[i]) continue;
+        set->pages_[i] = std::make_unique<std::size_t[]>(PAGE_SIZE);
+        std::copy_n(pages_[i].get(), PAGE_SIZE, set->pages_[i].get());
+      }
+      set->indices_ = indices_;
+      set->values_ = values_;
+      return set;
+    } else {
+      assert(false && "type is not copy constructible.");
+      return nullptr;
+    }
+  }
+
+  std::size_t size() const { return values_.size(); }
+
+ private:
+  std::size_t find_slot(std::size_t index) const {
+    auto page = index / PAGE_SIZE;
+    if (page >= pages_.size() || !pages_[page]) return 0;
+    return pages_[page][index % PAGE_SIZE];
+  }
+  std::size_t& get_or_new_slot(std::size_t index) {
+    auto page = index / PAGE_SIZE;
+    if (page >= pages_.size()) {
+      pages_.resize(page + 1);
+    }
+    if (!pages_[page]) {
+      pages_[page] = std::make_unique<std::size_t[]>(PAGE_SIZE);
+    }
+    return pages_[page][index % PAGE_SIZE];
+  }
+};
+
+namespace detail {
+
+inline std::size_t next_sparse_set_index() {
+  static std::atomic<std::size_t> index = 0;
+  return index++;
+}
+
+template <typename T>
+inline std::size_t sparse_set_index() {
+  static const std::size_t index = next_sparse_set_index();
+  return index;
+}
+
+}  // namespace detail
+
+// SparseSets.
+class SparseSets {
+ private:
+  SparseSets(const SparseSets&) = delete;
+  SparseSets(SparseSets&&) = delete;
+  SparseSets& operator=(const SparseSets&) = delete;
+  SparseSets& operator=(SparseSets&&) = delete;
+
+ private:
+  std::vector<std::unique_ptr<SparseSetBase>> sets_;
+
+ public:
+  SparseSets() = default;
+
+  template <typename T>
+  SparseSet<T>* find() const {
+    auto i = detail::sparse_set_index<T>();
+    if (i >= sets_.size()) return nullptr;
+    return static_cast<SparseSet<T>*>(sets_[i].get());
+  }
+
+  template <typename T>
+  SparseSet<T>* get_or_new() {
+    auto i = detail::sparse_set_index<T>();
+    if (i >= sets_.size()) {
+      sets_.resize(i + 1);
+    }
+    if (!sets_[i]) {
+      sets_[i] = std::make_unique<SparseSet<T>>();
+    }
+    return static_cast<SparseSet<T>*>(sets_[i].get());
+  }
+
+  void copy_all(std::size_t src_index, std::size_t dst_index) {
+    for (auto& set : sets_) {
+      if (set && set->contains(src_index)) {
+        set->copy(src_index, dst_index);
+      }
+    }
+  }
+  void remove_all(std::size_t index) {
+    for (auto& set : sets_) {
+      if (set) {
+        set->remove(index);
+      }
+    }
+  }
+  void clear() {
+    for (auto& set : sets_) {
+      if (set) {
+        set->clear();
+      }
+    }
+  }
+
+  // replace every set with a deep copy of the sets of |src|.
+  void copy_from(const SparseSets& src) {
+    sets_.clear();
+    sets_.resize(src.sets_.size());
+    for (std::size_t i = 0; i < src.sets_.size(); ++i) {
+      if (src.sets_[i]) {
+        sets_[i] = src.sets_[i]->clone();
+      }
+    }
+  }
+};
+
+}  // namespace ecs
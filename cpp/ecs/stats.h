@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+#if __has_include("imgui.h")
+#include "imgui.h"
+#endif
+
+namespace ecs {
+
+struct ArchetypeStats {
+  std::size_t type_count = 0;
+  std::size_t chunk_count = 0;
+  std::size_t chunk_size = 0;
+  std::size_t capacity = 0;
+  std::size_t live_rows = 0;
+  std::size_t row_size = 0;
+  std::size_t row_padding = 0;
+  std::size_t memory_size = 0;
+};
+
+struct RegistryStats {
+  std::vector<ArchetypeStats> archetypes;
+  std::size_t archetype_count = 0;
+  std::size_t chunk_count = 0;
+  std::size_t capacity = 0;
+  std::size_t live_rows = 0;
+  std::size_t padding_size = 0;
+  std::size_t entity_count = 0;
+  std::size_t free_index_count = 0;
+  std::size_t memory_size = 0;
+
+  double occupancy() const {
+    return capacity == 0 ? 0.0 : static_cast<double>(live_rows) / capacity;
+  }
+};
+
+inline void write_json(std::ostream& out, const ArchetypeStats& stats) {
+  out << "{\"type_count\":" << stats.type_count
+      << ",\"chunk_count\":" << stats.chunk_count
+      << ",\"chunk_size\":" << stats.chunk_size
+      << ",\"capacity\":" << stats.capacity
+      << ",\"live_rows\":" << stats.live_rows
+      << ",\"row_size\":" << stats.row_size
+      << ",\"row_padding\":" << stats.row_padding
+      << ",\"memory_size\":" << stats.memory_size << "}";
+}
+
+inline void write_json(std::ostream& out, const RegistryStats& stats) {
+  out << "{\"archetype_count\":" << stats.archetype_count
+      << ",\"chunk_count\":" << stats.chunk_count
+      << ",\"capacity\":" << stats.capacity
+      << ",\"live_rows\":" << stats.live_rows
+      << ",\"padding_size\":" << stats.padding_size
+      << ",\"entity_count\":" << stats.entity_count
+      << ",\"free_index_count\":" << stats.free_index_count
+      << ",\"memory_size\":" << stats.memory_size << ",\"archetypes\":[";
+  for (std::size_t i = 0; i < stats.archetypes.size(); ++i) {
+    if (i != 0) out << ",";
+    write_json(out, stats.archetypes[i]);
+  }
+  out << "]}";
+}
+
+#if __has_include("imgui.h")
+inline void on_debug_gui(const RegistryStats& stats) {
+  ImGui::Text("archetypes: %zu", stats.archetype_count);
+  ImGui::Text("chunks: %zu", stats.chunk_count);
+  ImGui::Text("rows: %zu / %zu (%.1f%%)", stats.live_rows, stats.capacity,
+              stats.occupancy() * 100.0);
+  ImGui::Text("entities: %zu (free: %zu)", stats.entity_count,
+              stats.free_index_count);
+  ImGui::Text("padding: %zu bytes", stats.padding_size);
+  ImGui::Text("memory: %zu bytes", stats.memory_size);
+
+  ImGui::Separator();
+
+  for (std::size_t i = 0; i < stats.archetypes.size(); ++i) {
+    auto& a = stats.archetypes[i];
+    if (!ImGui::TreeNode(reinterpret_cast<void*>(i), "archetype %zu", i)) {
+      continue;
+    }
+    ImGui::Text("types: %zu", a.type_count);
+    ImGui::Text("chunks: %zu (%zu bytes)", a.chunk_count, a.chunk_size);
+    ImGui::Text("rows: %zu / %zu", a.live_rows, a.capacity);
+    ImGui::Text("row size: %zu (padding: %zu)", a.row_size, a.row_padding);
+    ImGui::Text("memory: %zu bytes", a.memory_size);
+    ImGui::TreePop();
+  }
+}
+#endif
+
+}  // namespace ecs
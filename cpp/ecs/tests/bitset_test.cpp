@@ -0,0 +1,79 @@
+#include <memory>
+#include <vector>
+
+#include "bit.h"
+#include "chunk.h"
+#include "t9/check.h"
+
+namespace {
+
+struct Pos {
+  int x = 0;
+};
+
+void test_bits() {
+  ecs::BitWord words[3] = {};
+  for (std::size_t i : {0, 5, 63, 64, 130}) {
+    ecs::set_bit(words, i);
+  }
+  CHECK(ecs::test_bit(words, 63) && !ecs::test_bit(words, 62));
+  ecs::reset_bit(words, 5);
+  CHECK(!ecs::test_bit(words, 5));
+  CHECK(ecs::count_trailing_zeros(words[1]) == 0);
+  CHECK(ecs::count_trailing_zeros(words[2]) == 2);
+
+  std::vector<std::size_t> bits;
+  ecs::for_each_bit(words, 3, [&](std::size_t i) { bits.emplace_back(i); });
+  CHECK(bits == std::vector<std::size_t>({0, 63, 64, 130}));
+  CHECK(ecs::bit_word_count(64) == 1 && ecs::bit_word_count(65) == 2);
+}
+
+// occupancy across several words, with the first free row reused.
+void test_occupancy() {
+  std::shared_ptr<const ecs::Tuple> tuple = ecs::Tuple::make<Pos>();
+  ecs::Chunk chunk(tuple);
+  CHECK(chunk.capacity() > 2 * ecs::BIT_WORD_BITS);
+  CHECK(chunk.next_use(0) == chunk.capacity());
+
+  while (!chunk.is_full()) {
+    auto i = chunk.create();
+    chunk.get<Pos>(i)->x = static_cast<int>(i);
+  }
+  CHECK(chunk.count() == chunk.capacity());
+  for (std::size_t i = 0; i < chunk.capacity(); ++i) {
+    if (i % 7 != 3) chunk.destroy(i);
+  }
+
+  std::size_t n = 0;
+  for (auto i = chunk.next_use(0); i < chunk.capacity();
+       i = chunk.next_use(i + 1)) {
+    CHECK(i % 7 == 3);
+    CHECK(chunk.is_use(i));
+    CHECK(chunk.get<Pos>(i)->x == static_cast<int>(i));
+    ++n;
+  }
+  CHECK(n == chunk.count());
+  CHECK(chunk.next_use(4) == 10);
+  CHECK(chunk.next_use(60) == 66);  // across a word.
+
+  std::size_t each_n = 0;
+  chunk.each_index([&](std::size_t i) {
+    CHECK(i % 7 == 3);
+    ++each_n;
+  });
+  CHECK(each_n == n);
+
+  // the lowest free row is taken first.
+  CHECK(chunk.create() == 0);
+  CHECK(chunk.create() == 1);
+  chunk.destroy(ecs::BIT_WORD_BITS + 3);
+  CHECK(chunk.create() == 2);
+  CHECK(chunk.count() == n + 2);
+}
+
+}  // namespace
+
+int main() {
+  test_bits();
+  test_occupancy();
+}
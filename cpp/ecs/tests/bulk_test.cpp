@@ -0,0 +1,135 @@
+#include <vector>
+
+#include "registry.h"
+#include "t9/check.h"
+
+namespace {
+
+struct Pos {
+  float x = 0;
+  float y = 0;
+};
+struct Vel {
+  float x = 0;
+};
+struct Dead {};
+struct Tag {
+  int value = 0;
+};
+struct Stunned {
+  int turns = 0;
+};
+struct Big {
+  char bytes[256] = {};
+};
+
+}  // namespace
+
+namespace ecs {
+
+template <>
+struct component_traits<Tag> {
+  static constexpr StorageType storage = StorageType::SparseSet;
+};
+template <>
+struct component_traits<Stunned> {
+  static constexpr bool enableable = true;
+};
+
+}  // namespace ecs
+
+namespace {
+
+template <typename... Ts>
+int count(ecs::Registry* reg) {
+  int n = 0;
+  reg->query<const Ts&...>().each([&n](const Ts&...) { ++n; });
+  return n;
+}
+
+void test_table() {
+  ecs::Registry reg;
+  // more rows than one chunk holds.
+  for (int i = 0; i < 3000; ++i) {
+    auto id = reg.create_entity<Pos>();
+    reg.get_component<Pos>(id)->x = static_cast<float>(i);
+    if (i % 2 == 0) reg.add_component<Vel>(id);
+  }
+  CHECK((reg.add_component_to_query<Dead, Pos, Vel>() == 1500));
+  CHECK((count<Pos, Dead>(&reg) == 1500));
+  CHECK((reg.add_component_to_query<Dead, Pos, Vel>() == 0));
+
+  CHECK((reg.add_component_to_query<Vel, Pos>(Vel{2}) == 1500));
+  int fast = 0;
+  reg.query<const Vel&>().each([&fast](const Vel& v) {
+    if (v.x == 2) ++fast;
+  });
+  CHECK(fast == 1500);
+
+  CHECK((reg.remove_component_from_query<Dead, Pos>() == 1500));
+  CHECK((count<Dead>(&reg) == 0));
+  CHECK((count<Pos, Vel>(&reg) == 3000));
+  double sum = 0;
+  reg.query<const Pos&>().each([&sum](const Pos& p) { sum += p.x; });
+  CHECK(sum == 3000.0 * 2999 / 2);
+}
+
+// whole chunks are handed to an archetype with no room, keeping rows and
+// enabled bits in place.
+void test_chunk_hand_off() {
+  ecs::Registry reg;
+  std::vector<ecs::EntityId> ids;
+  // rows of 28 bytes, padded to 32 with or without Vel or Stunned.
+  for (int i = 0; i < 3000; ++i) {
+    ids.emplace_back(reg.create_entity<Pos, Stunned>());
+    reg.get_component<Pos>(ids.back())->x = static_cast<float>(i);
+    if (i % 3 == 0) reg.set_enabled<Stunned>(ids[i], false);
+  }
+  auto chunk_count = reg.stats().chunk_count;
+  std::vector<ecs::Chunk*> chunks;
+  reg.query<Pos>().each_chunk([&](ecs::Chunk* c) { chunks.emplace_back(c); });
+  CHECK((reg.add_component_to_query<Vel, Pos>(Vel{2}) == 3000));
+  CHECK(reg.stats().chunk_count == chunk_count);
+  std::vector<ecs::Chunk*> moved;
+  reg.query<Pos, Vel>().each_chunk(
+      [&](ecs::Chunk* c) { moved.emplace_back(c); });
+  CHECK(moved == chunks);
+  CHECK((count<Pos, Vel, Stunned>(&reg) == 2000));
+  for (int i = 0; i < 3000; ++i) {
+    CHECK(reg.get_component<Pos>(ids[i])->x == i);
+    CHECK(reg.get_component<Vel>(ids[i])->x == 2);
+    CHECK(reg.is_enabled<Stunned>(ids[i]) == (i % 3 != 0));
+  }
+
+  CHECK((reg.remove_component_from_query<Stunned, Vel>() == 3000));
+  CHECK(reg.stats().chunk_count == chunk_count);
+  CHECK((count<Pos, Vel>(&reg) == 3000));
+
+  // rows past the capacity for the larger rows move one at a time.
+  CHECK((reg.add_component_to_query<Big, Pos>() == 3000));
+  CHECK(reg.stats().chunk_count > chunk_count);
+  for (int i = 0; i < 3000; ++i) {
+    CHECK(reg.get_component<Pos>(ids[i])->x == i);
+    CHECK(reg.get_component<Big>(ids[i]));
+  }
+}
+
+void test_sparse() {
+  ecs::Registry reg;
+  for (int i = 0; i < 10; ++i) {
+    i % 2 == 0 ? reg.create_entity<Pos>() : reg.create_entity<Vel>();
+  }
+  CHECK((reg.add_component_to_query<Tag, Pos>(Tag{3}) == 5));
+  CHECK((count<Pos, Tag>(&reg) == 5));
+  CHECK((reg.remove_component_from_query<Tag, Vel>() == 0));
+  CHECK((reg.remove_component_from_query<Tag, Pos>() == 5));
+  CHECK((count<Tag>(&reg) == 0));
+}
+
+}  // namespace
+
+int main() {
+  test_table();
+  test_chunk_hand_off();
+  test_sparse();
+}
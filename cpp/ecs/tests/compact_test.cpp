@@ -0,0 +1,80 @@
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "registry.h"
+#include "t9/check.h"
+
+namespace {
+
+struct Pos {
+  int x = 0;
+  int y = 0;
+};
+
+struct Lock {
+  std::mutex mutex;
+  int value = 0;
+};
+
+// components and ids survive compaction after scattered destroys.
+void test_compact_after_destroy() {
+  ecs::Registry reg;
+  std::vector<ecs::EntityId> ids;
+  for (int i = 0; i < 1000; ++i) {
+    ids.emplace_back(reg.create_entity<Pos>());
+    *reg.get_component<Pos>(ids.back()) = Pos{i, -i};
+  }
+  auto chunk_count = reg.stats().chunk_count;
+  for (int i = 0; i < 1000; ++i) {
+    if (i % 3 != 0) reg.destroy_entity(ids[i]);
+  }
+  while (!reg.compact(std::chrono::microseconds(10))) {
+  }
+  auto stats = reg.stats();
+  CHECK(stats.chunk_count < chunk_count);
+  CHECK(stats.live_rows == 334);
+
+  int n = 0;
+  reg.query<ecs::EntityId, const Pos>().each(
+      [&](ecs::EntityId id, const Pos& pos) {
+        CHECK(ids[pos.x].index == id.index);
+        CHECK(pos.y == -pos.x);
+        ++n;
+      });
+  CHECK(n == 334);
+  for (int i = 0; i < 1000; i += 3) {
+    auto pos = reg.get_component<Pos>(ids[i]);
+    CHECK(pos && pos->x == i);
+  }
+}
+
+// rows holding a component that cannot be moved stay in place.
+void test_unmovable() {
+  ecs::Registry reg;
+  std::vector<ecs::EntityId> ids;
+  for (int i = 0; i < 100; ++i) {
+    ids.emplace_back(reg.create_entity<Lock>());
+    reg.get_component<Lock>(ids.back())->value = i;
+  }
+  for (int i = 0; i < 100; i += 2) {
+    reg.destroy_entity(ids[i]);
+  }
+  CHECK(reg.compact(std::chrono::microseconds(1000)));
+  CHECK(!reg.add_component<Pos>(ids[1]));
+  CHECK(reg.get_component<Lock>(ids[1])->value == 1);
+  CHECK(reg.remove_component<Lock>(ids[1]));
+  CHECK(!reg.get_component<Lock>(ids[1]));
+  CHECK(reg.add_component<Pos>(ids[1]));
+  CHECK(reg.add_component<Lock>(ids[1]));
+  for (int i = 3; i < 100; i += 2) {
+    CHECK(reg.get_component<Lock>(ids[i])->value == i);
+  }
+}
+
+}  // namespace
+
+int main() {
+  test_compact_after_destroy();
+  test_unmovable();
+}
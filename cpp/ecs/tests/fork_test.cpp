@@ -0,0 +1,73 @@
+#include "history.h"
+#include "registry.h"
+#include "t9/check.h"
+
+namespace {
+
+struct Pos {
+  float x = 0;
+};
+struct Tag {
+  int value = 0;
+};
+
+}  // namespace
+
+namespace ecs {
+
+template <>
+struct component_traits<Tag> {
+  static constexpr StorageType storage = StorageType::SparseSet;
+};
+
+}  // namespace ecs
+
+namespace {
+
+void test_fork() {
+  ecs::Registry reg;
+  auto a = reg.create_entity<Pos>();
+  auto b = reg.create_entity<Pos>();
+  reg.add_component<Tag>(a, Tag{1});
+
+  auto fork = reg.fork();
+  reg.get_component<Pos>(a)->x = 1;
+  reg.destroy_entity(b);
+  reg.get_component<Tag>(a)->value = 2;
+  fork->create_entity<Pos>();
+
+  CHECK(fork->get_component<Pos>(a)->x == 0);
+  CHECK(fork->is_valid(b));
+  CHECK(fork->get_component<Tag>(a)->value == 1);
+  CHECK(!reg.is_valid(b));
+  CHECK(reg.stats().live_rows == 1);
+  CHECK(fork->stats().live_rows == 3);
+}
+
+void test_history() {
+  ecs::Registry reg;
+  auto id = reg.create_entity<Pos>();
+  ecs::RegistryHistory history(3);
+  for (int i = 0; i < 5; ++i) {
+    reg.get_component<Pos>(id)->x = static_cast<float>(i);
+    history.push(&reg);
+  }
+  CHECK(history.size() == 3);
+  CHECK(history.get(0)->get_component<Pos>(id)->x == 4);
+  CHECK(history.get(2)->get_component<Pos>(id)->x == 2);
+  CHECK(!history.get(3));
+
+  auto back = history.rollback(1);
+  CHECK(back->get_component<Pos>(id)->x == 3);
+  CHECK(history.size() == 2);
+  back->get_component<Pos>(id)->x = 10;
+  CHECK(history.get(0)->get_component<Pos>(id)->x == 3);
+  CHECK(!history.rollback(2));
+}
+
+}  // namespace
+
+int main() {
+  test_fork();
+  test_history();
+}
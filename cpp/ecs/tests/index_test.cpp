@@ -0,0 +1,66 @@
+#include <vector>
+
+#include "registry.h"
+#include "t9/check.h"
+
+namespace {
+
+struct Team {
+  int id = 0;
+};
+struct Pos {
+  float x = 0;
+};
+
+void test_hash_index() {
+  ecs::Registry reg;
+  auto index = reg.add_hash_index<Team>([](const Team& t) { return t.id; });
+  std::vector<ecs::EntityId> ids;
+  for (int i = 0; i < 10; ++i) {
+    ids.emplace_back(reg.create_entity<Team>());
+    reg.patch<Team>(ids.back(), [i](Team& t) { t.id = i % 3; });
+  }
+  CHECK(index->size() == 10);
+  CHECK(index->count(0) == 4);
+  CHECK(index->count(1) == 3);
+
+  reg.patch<Team>(ids[0], [](Team& t) { t.id = 1; });
+  CHECK(index->count(0) == 3);
+  CHECK(index->count(1) == 4);
+
+  reg.destroy_entity(ids[1]);
+  CHECK(index->count(1) == 3);
+  reg.remove_component<Team>(ids[4]);
+  CHECK(index->count(1) == 2);
+  reg.add_component<Team>(ids[4], Team{2});
+  CHECK(index->count(2) == 4);
+
+  // a write through get_component() is seen after reindex().
+  reg.get_component<Team>(ids[2])->id = 7;
+  CHECK(index->count(7) == 0);
+  reg.reindex<Team>(ids[2]);
+  CHECK(index->find(7).index == ids[2].index);
+  CHECK(!reg.is_valid(index->find(8)));
+}
+
+void test_ordered_index() {
+  ecs::Registry reg;
+  auto index = reg.add_ordered_index<Pos>([](const Pos& p) { return p.x; });
+  for (int i = 0; i < 10; ++i) {
+    auto id = reg.create_entity<Pos>();
+    reg.patch<Pos>(id, [i](Pos& p) { p.x = static_cast<float>(9 - i); });
+  }
+  std::vector<float> xs;
+  index->each_range(2.0f, 5.0f, [&](ecs::EntityId id) {
+    xs.emplace_back(reg.get_component<Pos>(id)->x);
+  });
+  CHECK((xs == std::vector<float>{2, 3, 4}));
+  CHECK(index->count(9.0f) == 1);
+}
+
+}  // namespace
+
+int main() {
+  test_hash_index();
+  test_ordered_index();
+}
@@ -0,0 +1,60 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "registry.h"
+#include "t9/check.h"
+
+namespace {
+
+struct Name {
+  std::string value;
+};
+struct Items {
+  std::vector<int> values;
+  std::shared_ptr<int> owner;
+};
+struct Pos {
+  int x = 0;
+};
+
+// non-trivially-copyable components are copy constructed per instance.
+void test_instantiate() {
+  ecs::Registry reg;
+  auto prefab = reg.create_entity<Name, Items, Pos>();
+  reg.get_component<Name>(prefab)->value = "a name longer than the sso buffer";
+  auto owner = std::make_shared<int>(7);
+  *reg.get_component<Items>(prefab) = Items{{1, 2, 3}, owner};
+
+  int x = 0;
+  auto ids = reg.instantiate(prefab, 100, [&x](Pos& pos) { pos.x = ++x; });
+  CHECK(ids.size() == 100);
+  CHECK(owner.use_count() == 102);
+  for (std::size_t i = 0; i < ids.size(); ++i) {
+    auto name = reg.get_component<Name>(ids[i]);
+    auto items = reg.get_component<Items>(ids[i]);
+    CHECK(name->value == "a name longer than the sso buffer");
+    CHECK(items->values == std::vector<int>({1, 2, 3}));
+    CHECK(items->owner == owner);
+    CHECK(reg.get_component<Pos>(ids[i])->x == static_cast<int>(i) + 1);
+  }
+
+  // instances own their copies.
+  reg.get_component<Name>(ids[0])->value = "other";
+  reg.get_component<Items>(ids[0])->values.push_back(4);
+  CHECK(reg.get_component<Name>(prefab)->value ==
+        "a name longer than the sso buffer");
+  CHECK(reg.get_component<Items>(prefab)->values.size() == 3);
+  CHECK(reg.get_component<Pos>(prefab)->x == 0);
+
+  for (auto id : ids) {
+    reg.destroy_entity(id);
+  }
+  CHECK(owner.use_count() == 2);
+  reg.destroy_all_entities();
+  CHECK(owner.use_count() == 1);
+}
+
+}  // namespace
+
+int main() { test_instantiate(); }
@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <vector>
+
+#include "registry.h"
+#include "t9/check.h"
+
+namespace {
+
+struct Pos {
+  float x = 0;
+};
+struct Vel {
+  float x = 0;
+};
+struct Tag {
+  int value = 0;
+};
+
+}  // namespace
+
+namespace ecs {
+
+template <>
+struct component_traits<Tag> {
+  static constexpr StorageType storage = StorageType::SparseSet;
+};
+
+}  // namespace ecs
+
+namespace {
+
+std::vector<std::size_t> read(const ecs::Journal* journal,
+                              ecs::Journal::Cursor* cursor) {
+  std::vector<std::size_t> indices;
+  journal->read(cursor,
+                [&indices](ecs::EntityId id) { indices.emplace_back(id.index); });
+  return indices;
+}
+
+void test_journals() {
+  ecs::Registry reg;
+  auto vel_removed = reg.track_removals<Vel>();
+  auto tag_removed = reg.track_removals<Tag>();
+  auto destroyed = reg.track_destructions();
+  CHECK(reg.track_removals<Vel>() == vel_removed);
+
+  std::vector<ecs::EntityId> ids;
+  for (int i = 0; i < 6; ++i) {
+    ids.emplace_back(reg.create_entity<Pos, Vel>());
+    reg.add_component<Tag>(ids.back());
+  }
+  ecs::Journal::Cursor vel_cursor = vel_removed->begin();
+  ecs::Journal::Cursor tag_cursor = tag_removed->begin();
+  ecs::Journal::Cursor destroyed_cursor = destroyed->begin();
+
+  reg.remove_component<Vel>(ids[0]);
+  reg.remove_component<Tag>(ids[1]);
+  reg.destroy_entity(ids[2]);
+  CHECK((read(vel_removed, &vel_cursor) == std::vector<std::size_t>{0, 2}));
+  CHECK((read(tag_removed, &tag_cursor) == std::vector<std::size_t>{1, 2}));
+  CHECK((read(destroyed, &destroyed_cursor) == std::vector<std::size_t>{2}));
+  CHECK(read(vel_removed, &vel_cursor).empty());
+
+  // a second reader still sees the entries until they are trimmed.
+  ecs::Journal::Cursor late = vel_removed->begin();
+  CHECK((reg.remove_component_from_query<Vel, Pos>() == 4));
+  vel_removed->trim(vel_cursor);
+  auto removed = read(vel_removed, &late);
+  std::sort(removed.begin(), removed.end());
+  CHECK((removed == std::vector<std::size_t>{1, 3, 4, 5}));
+  CHECK(read(vel_removed, &vel_cursor).size() == 4);
+
+  reg.destroy_all_entities();
+  CHECK(read(destroyed, &destroyed_cursor).size() == 5);
+  CHECK(read(tag_removed, &tag_cursor).size() == 4);
+  reg.clear_journals();
+  CHECK(vel_removed->empty() && tag_removed->empty() && destroyed->empty());
+}
+
+}  // namespace
+
+int main() { test_journals(); }
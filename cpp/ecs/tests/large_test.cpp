@@ -0,0 +1,41 @@
+#include <cstdint>
+#include <vector>
+
+#include "registry.h"
+#include "t9/check.h"
+
+namespace {
+
+// larger than the default 16KB chunk buffer.
+struct Heightmap {
+  std::uint16_t heights[128 * 128] = {};
+};
+
+// a chunk of large rows still holds a few rows.
+void test_large_rows() {
+  ecs::Registry reg;
+  std::vector<ecs::EntityId> ids;
+  for (int i = 0; i < 20; ++i) {
+    ids.emplace_back(reg.create_entity<Heightmap>());
+    auto map = reg.get_component<Heightmap>(ids.back());
+    map->heights[0] = static_cast<std::uint16_t>(i);
+    map->heights[128 * 128 - 1] = static_cast<std::uint16_t>(i + 1);
+  }
+  auto stats = reg.stats();
+  CHECK(stats.archetypes.size() == 1);
+  auto& a = stats.archetypes[0];
+  auto rows = a.capacity / a.chunk_count;
+  CHECK(rows >= 8);
+  CHECK(a.chunk_size >= rows * a.row_size);
+  CHECK(a.chunk_count == (20 + rows - 1) / rows);
+
+  for (int i = 0; i < 20; ++i) {
+    auto map = reg.get_component<Heightmap>(ids[i]);
+    CHECK(map->heights[0] == i);
+    CHECK(map->heights[128 * 128 - 1] == i + 1);
+  }
+}
+
+}  // namespace
+
+int main() { test_large_rows(); }
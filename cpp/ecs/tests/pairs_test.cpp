@@ -0,0 +1,97 @@
+#include <atomic>
+#include <set>
+#include <utility>
+
+#include "pairs.h"
+#include "registry.h"
+#include "t9/check.h"
+
+namespace {
+
+struct Body {
+  int id = 0;
+};
+struct Force {
+  int n = 0;
+};
+struct Frozen {
+  bool frozen = true;
+};
+
+}  // namespace
+
+namespace ecs {
+
+template <>
+struct component_traits<Frozen> {
+  static constexpr bool enableable = true;
+};
+
+}  // namespace ecs
+
+namespace {
+
+constexpr int BODY_N = 1000;
+
+ecs::Registry* make_bodies(ecs::Registry* reg) {
+  for (int i = 0; i < BODY_N; ++i) {
+    auto id = reg->create_entity<Body, Force, Frozen>();
+    reg->get_component<Body>(id)->id = i;
+    reg->set_enabled<Frozen>(id, false);
+  }
+  return reg;
+}
+
+void test_unordered_pairs() {
+  ecs::Registry reg;
+  make_bodies(&reg);
+  std::set<std::pair<int, int>> seen;
+  ecs::pairs(reg.query<const Body&>(), [&](const Body& a, const Body& b) {
+    CHECK(a.id != b.id);
+    CHECK(seen.emplace(std::min(a.id, b.id), std::max(a.id, b.id)).second);
+  });
+  CHECK(seen.size() == BODY_N * (BODY_N - 1) / 2);
+
+  // any callable of the executor shape runs the chunks.
+  std::size_t calls = 0;
+  std::atomic<int> n = 0;
+  auto exec = [&calls](std::size_t chunk_n, auto&& f) {
+    ++calls;
+    for (auto i = chunk_n; i-- > 0;) f(i);
+  };
+  ecs::pairs(reg.query<const Body&>(),
+             [&n](const Body&, const Body&) { ++n; }, exec);
+  CHECK(calls == 1);
+  CHECK(n == BODY_N * (BODY_N - 1) / 2);
+}
+
+void test_pairs_between_queries() {
+  ecs::Registry reg;
+  make_bodies(&reg);
+  auto frozen = reg.create_entity<Body, Frozen>();
+  reg.get_component<Body>(frozen)->id = -1;
+
+  ecs::pairs(
+      reg.query<const Body&, Force&>(), reg.query<const Body&, const Frozen&>(),
+      [](const Body&, Force& force, const Body& b, const Frozen&) {
+        CHECK(b.id == -1);
+        ++force.n;
+      },
+      ecs::ThreadFor{4});
+  int n = 0;
+  reg.query<const Force&>().each([&n](const Force& f) { n += f.n; });
+  CHECK(n == BODY_N);
+
+  ecs::pairs(reg.query<const Body&, Force&>(), reg.query<const Body&>(),
+             [](const Body&, Force& force, const Body&) { ++force.n; },
+             ecs::ThreadFor{4});
+  reg.query<const Force&>().each(
+      [](const Force& f) { CHECK(f.n == 1 + BODY_N + 1); });
+}
+
+}  // namespace
+
+int main() {
+  test_unordered_pairs();
+  test_pairs_between_queries();
+}
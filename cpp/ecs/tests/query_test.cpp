@@ -0,0 +1,107 @@
+#include <vector>
+
+#include "registry.h"
+#include "t9/check.h"
+
+namespace {
+
+struct Pos {
+  float x = 0;
+};
+struct Stunned {
+  int turns = 0;
+};
+struct Tag {
+  int value = 0;
+};
+
+}  // namespace
+
+namespace ecs {
+
+template <>
+struct component_traits<Stunned> {
+  static constexpr bool enableable = true;
+};
+template <>
+struct component_traits<Tag> {
+  static constexpr StorageType storage = StorageType::SparseSet;
+};
+
+}  // namespace ecs
+
+namespace {
+
+static_assert(std::is_same_v<ecs::enableable_types_t<Pos, const Stunned&,
+                                                     Tag&, ecs::EntityId>,
+                             ecs::type_list<const Stunned&>>);
+
+// rows spanning several bit words, some disabled and some without Tag.
+void test_iterator_masks() {
+  ecs::Registry reg;
+  std::vector<ecs::EntityId> ids;
+  for (int i = 0; i < 300; ++i) {
+    auto id = reg.create_entity<Pos, Stunned>();
+    reg.get_component<Pos>(id)->x = static_cast<float>(i);
+    if (i % 3 == 0) reg.set_enabled<Stunned>(id, false);
+    if (i % 2 == 0) reg.add_component<Tag>(id, Tag{i});
+    ids.emplace_back(id);
+  }
+  reg.destroy_entity(ids[64]);
+  reg.destroy_entity(ids[65]);
+
+  int enabled_n = 0;
+  for (auto [id, pos, stunned] :
+       reg.query<ecs::EntityId, const Pos&, const Stunned&>()) {
+    (void)stunned;
+    CHECK(id.index % 3 != 0 && id.index != 64 && id.index != 65);
+    CHECK(pos.x == static_cast<float>(id.index));
+    ++enabled_n;
+  }
+  CHECK(enabled_n == 300 - 100 - 2);
+
+  int tagged_n = 0;
+  for (auto [id, stunned, tag] :
+       reg.query<ecs::EntityId, Stunned&, Tag&>()) {
+    CHECK(id.index % 6 != 0 && id.index % 2 == 0 && id.index != 64);
+    CHECK(tag.value == static_cast<int>(id.index));
+    stunned.turns = 1;
+    ++tagged_n;
+  }
+  CHECK(tagged_n == 100 - 1);
+
+  int each_n = 0;
+  reg.query<const Stunned&, const Tag&>().each(
+      [&](const Stunned& stunned, const Tag&) {
+        CHECK(stunned.turns == 1);
+        ++each_n;
+      });
+  CHECK(each_n == tagged_n);
+
+  // an enableable type not in the query does not mask rows.
+  int pos_n = 0;
+  for (auto [pos] : reg.query<const Pos&>()) {
+    (void)pos;
+    ++pos_n;
+  }
+  CHECK(pos_n == 298);
+}
+
+// a writing iterator detaches the chunk from a fork.
+void test_iterator_detaches() {
+  ecs::Registry reg;
+  auto id = reg.create_entity<Pos>();
+  auto fork = reg.fork();
+  for (auto [pos] : reg.query<Pos&>()) {
+    pos.x = 5;
+  }
+  CHECK(reg.get_component<Pos>(id)->x == 5);
+  CHECK(fork->get_component<Pos>(id)->x == 0);
+}
+
+}  // namespace
+
+int main() {
+  test_iterator_masks();
+  test_iterator_detaches();
+}
@@ -0,0 +1,81 @@
+#include "registry.h"
+#include "t9/check.h"
+
+namespace {
+
+struct Pos {
+  float x = 0;
+  float y = 0;
+};
+
+// reserved entities flushed by create_entity<>() must not overflow the
+// chunk it has chosen.
+void test_create_after_reserve() {
+  ecs::Registry reg;
+  reg.create_entity<>();
+  auto capacity = reg.stats().archetypes[0].capacity;
+  for (std::size_t i = 1; i + 1 < capacity; ++i) {
+    reg.create_entity<>();
+  }
+  auto a = reg.reserve_entity();
+  auto b = reg.reserve_entity();
+  auto c = reg.create_entity<>();
+  CHECK(reg.is_valid(a));
+  CHECK(reg.is_valid(b));
+  CHECK(reg.is_valid(c));
+  CHECK(reg.stats().live_rows == capacity + 2);
+
+  auto d = reg.create_entity(nullptr, 0);
+  CHECK(reg.is_valid(d));
+}
+
+// reserved entities are counted before they are flushed.
+void test_stats_of_reserved() {
+  ecs::Registry reg;
+  auto a = reg.create_entity<>();
+  reg.create_entity<>();
+  reg.destroy_entity(a);
+  CHECK(reg.stats().entity_count == 1);
+  CHECK(reg.stats().free_index_count == 1);
+  reg.reserve_entity();
+  reg.reserve_entity();
+  CHECK(reg.stats().entity_count == 3);
+  CHECK(reg.stats().free_index_count == 0);
+  reg.flush_reserved_entities();
+  CHECK(reg.stats().entity_count == 3);
+}
+
+void test_add_to_reserved() {
+  ecs::Registry reg;
+  auto id = reg.reserve_entity();
+  auto pos = reg.add_component<Pos>(id, Pos{1, 2});
+  CHECK(pos);
+  CHECK(pos->x == 1 && pos->y == 2);
+  CHECK(reg.get_component<Pos>(id) == pos);
+
+  auto other = reg.reserve_entity();
+  CHECK(!reg.remove_component<Pos>(other));
+  CHECK(reg.is_valid(other));
+  CHECK(reg.add_component(reg.reserve_entity(), ecs::Type::get<Pos>()));
+}
+
+void test_instantiate_after_reserve() {
+  ecs::Registry reg;
+  auto prefab = reg.create_entity<Pos>();
+  auto id = reg.reserve_entity();
+  auto ids = reg.instantiate(prefab, 3);
+  CHECK(ids.size() == 3);
+  CHECK(reg.is_valid(id));
+  for (auto i : ids) {
+    CHECK(i.index != id.index);
+  }
+}
+
+}  // namespace
+
+int main() {
+  test_create_after_reserve();
+  test_stats_of_reserved();
+  test_add_to_reserved();
+  test_instantiate_after_reserve();
+}
@@ -0,0 +1,80 @@
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "registry.h"
+#include "t9/check.h"
+
+namespace {
+
+struct Pos {
+  float x = 0;
+};
+
+// a 12 byte component described at runtime.
+const ecs::Type* make_blob_type() {
+  return ecs::Type::make(
+      12, 4, [](void* p) { std::memset(p, 0, 12); }, [](void*) {},
+      [](void* dst, void* src) { std::memcpy(dst, src, 12); },
+      [](void* dst, const void* src) { std::memcpy(dst, src, 12); }, true);
+}
+
+// a component owning memory, to check its functions are called.
+const ecs::Type* make_string_type() {
+  return ecs::Type::make(
+      sizeof(std::string), alignof(std::string),
+      [](void* p) { new (p) std::string("x"); },
+      [](void* p) { static_cast<std::string*>(p)->~basic_string(); },
+      [](void* dst, void* src) {
+        new (dst) std::string(std::move(*static_cast<std::string*>(src)));
+      },
+      [](void* dst, const void* src) {
+        new (dst) std::string(*static_cast<const std::string*>(src));
+      });
+}
+
+void test_runtime_types() {
+  auto blob = make_blob_type();
+  auto str = make_string_type();
+  ecs::Registry reg;
+  const ecs::Type* types[] = {blob, ecs::Type::get<Pos>()};
+  for (int i = 0; i < 100; ++i) {
+    auto id = reg.create_entity(types, 2);
+    static_cast<int*>(reg.get_component(id, blob))[0] = i;
+    reg.get_component<Pos>(id)->x = static_cast<float>(i);
+    if (i % 4 == 0) {
+      CHECK(reg.add_component(id, str));
+      *static_cast<std::string*>(reg.get_component(id, str)) += "y";
+    }
+  }
+
+  // columns follow the order of the query types, not the sorted order.
+  const ecs::Type* query_types[] = {ecs::Type::get<Pos>(), str, blob};
+  int n = 0;
+  reg.query(query_types, 3).each([&n](void* const* columns) {
+    auto x = static_cast<const Pos*>(columns[0])->x;
+    CHECK(*static_cast<const std::string*>(columns[1]) == "xy");
+    CHECK(static_cast<const int*>(columns[2])[0] == static_cast<int>(x));
+    ++n;
+  });
+  CHECK(n == 25);
+
+  // typed queries see runtime typed entities too.
+  std::vector<ecs::EntityId> ids;
+  reg.query<ecs::EntityId, const Pos&>().each(
+      [&ids](ecs::EntityId id, const Pos&) { ids.emplace_back(id); });
+  CHECK(ids.size() == 100);
+  n = 0;
+  for (auto id : ids) {
+    if (reg.remove_component(id, str)) ++n;
+  }
+  CHECK(n == 25);
+  CHECK(!reg.remove_component(ecs::EntityId{}, blob));
+  n = 0;
+  reg.query(query_types, 3).each([&n](void* const*) { ++n; });
+  CHECK(n == 0);
+}
+
+}  // namespace
+
+int main() { test_runtime_types(); }
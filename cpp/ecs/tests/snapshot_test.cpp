@@ -0,0 +1,161 @@
+#include <vector>
+
+#include "registry.h"
+#include "t9/check.h"
+
+namespace {
+
+struct Pos {
+  float x = 0;
+  float y = 0;
+};
+struct Hp {
+  int value = 0;
+};
+
+void test_full_snapshot_with_gaps() {
+  ecs::Registry src;
+  auto a = src.create_entity<Pos>();
+  auto b = src.create_entity<Pos>();
+  auto c = src.create_entity<Pos>();
+  *src.get_component<Pos>(c) = Pos{3, 4};
+  src.destroy_entity(a);
+  src.destroy_entity(b);
+
+  ecs::SnapshotSchema schema;
+  schema.add<ecs::EntityId>().add<Pos>();
+  std::vector<std::uint8_t> data;
+  src.write_delta(nullptr, schema, &data);
+
+  ecs::Registry dst;
+  CHECK(dst.apply_delta(data.data(), data.size(), schema));
+  CHECK(dst.is_valid(c));
+  CHECK(dst.get_component<Pos>(c)->x == 3);
+
+  // gap slots are free, not entities with the invalid id.
+  CHECK(!dst.is_valid(ecs::EntityId{}));
+  CHECK(!dst.destroy_entity(ecs::EntityId{}));
+  CHECK(!dst.destroy_entity(ecs::EntityId{0, 1}));
+  for (int i = 0; i < 2; ++i) {
+    auto id = dst.create_entity<Pos>();
+    CHECK(id.generation != 0);
+    CHECK(dst.is_valid(id));
+  }
+}
+
+void test_delta_since_fork() {
+  ecs::Registry src;
+  std::vector<ecs::EntityId> ids;
+  for (int i = 0; i < 8; ++i) {
+    ids.emplace_back(src.create_entity<Pos, Hp>());
+    src.get_component<Hp>(ids.back())->value = i;
+  }
+  ecs::SnapshotSchema schema;
+  schema.add<ecs::EntityId>().add<Pos>().add<Hp>();
+  std::vector<std::uint8_t> data;
+  src.write_delta(nullptr, schema, &data);
+  ecs::Registry dst;
+  CHECK(dst.apply_delta(data.data(), data.size(), schema));
+
+  auto baseline = src.fork();
+  src.get_component<Hp>(ids[2])->value = 20;
+  src.destroy_entity(ids[5]);
+  auto spawned = src.create_entity<Pos>();
+  src.get_component<Pos>(spawned)->y = 7;
+  src.remove_component<Hp>(ids[1]);
+
+  data.clear();
+  src.write_delta(baseline.get(), schema, &data);
+  CHECK(dst.apply_delta(data.data(), data.size(), schema));
+  CHECK(dst.get_component<Hp>(ids[2])->value == 20);
+  CHECK(!dst.is_valid(ids[5]));
+  CHECK(dst.get_component<Pos>(spawned)->y == 7);
+  CHECK(!dst.get_component<Hp>(ids[1]));
+  CHECK(dst.get_component<Hp>(ids[7])->value == 7);
+
+  // the fork still sees the state it was taken at.
+  CHECK(baseline->get_component<Hp>(ids[2])->value == 2);
+  CHECK(baseline->is_valid(ids[5]));
+
+  CHECK(!dst.apply_delta(data.data(), data.size() / 2, schema));
+}
+
+// a spawn or destroy far past the entity table is malformed.
+void test_index_out_of_bounds() {
+  ecs::SnapshotSchema schema;
+  schema.add<ecs::EntityId>().add<Pos>();
+  for (auto kind : {ecs::DeltaRecord::Spawn, ecs::DeltaRecord::Destroy}) {
+    std::vector<std::uint8_t> data;
+    ecs::DeltaWriter writer(&data, schema);
+    writer.record(kind, ecs::EntityId{1, std::size_t(1) << 40});
+    writer.write(std::uint32_t(0));
+    writer.record(ecs::DeltaRecord::End);
+    ecs::Registry dst;
+    CHECK(!dst.apply_delta(data.data(), data.size(), schema));
+    CHECK(dst.stats().free_index_count == 0);
+  }
+}
+
+// trailing free indices are replicated, so deltas against a later fork
+// fit the reader's table.
+void test_trailing_free_indices() {
+  ecs::Registry src;
+  std::vector<ecs::EntityId> ids;
+  for (int i = 0; i < 100; ++i) {
+    ids.emplace_back(src.create_entity<Pos>());
+  }
+  for (int i = 1; i < 100; ++i) {
+    src.destroy_entity(ids[i]);
+  }
+  ecs::SnapshotSchema schema;
+  schema.add<ecs::EntityId>().add<Pos>();
+  std::vector<std::uint8_t> data;
+  src.write_delta(nullptr, schema, &data);
+  ecs::Registry dst;
+  CHECK(dst.apply_delta(data.data(), data.size(), schema));
+  CHECK(dst.stats().free_index_count == 99);
+
+  auto baseline = src.fork();
+  for (int i = 0; i < 120; ++i) {
+    src.create_entity<Pos>();
+  }
+  src.destroy_entity(ids[0]);
+  data.clear();
+  src.write_delta(baseline.get(), schema, &data);
+  CHECK(dst.apply_delta(data.data(), data.size(), schema));
+  CHECK(dst.stats().entity_count == 120);
+  CHECK(!dst.is_valid(ids[0]));
+}
+
+// an existing entity whose spawn lacks a component loses it through the
+// removal journals.
+void test_respawn_journals_removals() {
+  ecs::Registry src;
+  auto id = src.create_entity<Pos, Hp>();
+  ecs::SnapshotSchema schema;
+  schema.add<ecs::EntityId>().add<Pos>();
+  std::vector<std::uint8_t> data;
+  src.write_delta(nullptr, schema, &data);
+
+  ecs::Registry dst;
+  CHECK(dst.apply_delta(data.data(), data.size(), schema));
+  CHECK(dst.add_component<Hp>(id));
+  auto journal = dst.track_removals<Hp>();
+  ecs::Journal::Cursor cursor = {};
+  CHECK(dst.apply_delta(data.data(), data.size(), schema));
+  CHECK(dst.is_valid(id));
+  CHECK(!dst.get_component<Hp>(id));
+  std::vector<ecs::EntityId> removed;
+  journal->read(&cursor, [&](ecs::EntityId e) { removed.emplace_back(e); });
+  CHECK(removed.size() == 1 && removed[0].index == id.index);
+}
+
+}  // namespace
+
+int main() {
+  test_full_snapshot_with_gaps();
+  test_delta_since_fork();
+  test_index_out_of_bounds();
+  test_trailing_free_indices();
+  test_respawn_journals_removals();
+}
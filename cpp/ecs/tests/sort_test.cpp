@@ -0,0 +1,105 @@
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "registry.h"
+#include "t9/check.h"
+
+namespace {
+
+struct Pos {
+  std::uint32_t x = 0;
+  std::uint32_t y = 0;
+};
+struct Check {
+  std::uint32_t x = 0;
+};
+struct Depth {
+  std::uint32_t z = 0;
+};
+
+std::uint64_t key_of(const Pos& p) { return ecs::morton_code(p.x, p.y); }
+
+// check that rows are in key order and still belong to their entities.
+void check_sorted(ecs::Registry* reg, std::size_t n) {
+  std::uint64_t last = 0;
+  std::size_t count = 0;
+  for (auto [id, pos, check] :
+       reg->query<ecs::EntityId, const Pos&, const Check&>()) {
+    CHECK(key_of(pos) >= last);
+    CHECK(pos.x == check.x);
+    CHECK(reg->get_component<Pos>(id) == &pos);
+    last = key_of(pos);
+    ++count;
+  }
+  CHECK(count == n);
+}
+
+void test_sort_rows() {
+  constexpr std::size_t N = 5000;
+  ecs::Registry reg;
+  std::uint32_t seed = 1;
+  std::vector<ecs::EntityId> ids;
+  for (std::size_t i = 0; i < N; ++i) {
+    seed = seed * 1664525 + 1013904223;
+    auto id = reg.create_entity<Pos, Check>();
+    *reg.get_component<Pos>(id) = Pos{seed >> 20, (seed >> 8) & 0xfff};
+    reg.get_component<Check>(id)->x = seed >> 20;
+    ids.emplace_back(id);
+  }
+
+  // a zero budget still makes progress on every call.
+  int calls = 1;
+  while (!reg.sort_rows<Pos>(key_of, std::chrono::microseconds(0))) {
+    CHECK(++calls < 100000);
+  }
+  check_sorted(&reg, N);
+
+  // moving a few rows needs only another pass.
+  for (std::size_t i = 0; i < N; i += 500) {
+    reg.get_component<Pos>(ids[i])->x = 0;
+    reg.get_component<Check>(ids[i])->x = 0;
+  }
+  CHECK(reg.sort_rows<Pos>(key_of, std::chrono::seconds(10)));
+  check_sorted(&reg, N);
+}
+
+// sorts by different types resume from their own cursors.
+void test_interleaved_sorts() {
+  constexpr std::size_t N = 5000;
+  ecs::Registry reg;
+  std::uint32_t seed = 1;
+  for (std::size_t i = 0; i < N; ++i) {
+    seed = seed * 1664525 + 1013904223;
+    auto id = reg.create_entity<Pos, Check>();
+    *reg.get_component<Pos>(id) = Pos{seed >> 20, (seed >> 8) & 0xfff};
+    reg.get_component<Check>(id)->x = seed >> 20;
+    reg.get_component<Depth>(reg.create_entity<Depth>())->z = seed;
+  }
+  auto depth_of = [](const Depth& d) { return d.z; };
+  bool pos_sorted = false;
+  bool depth_sorted = false;
+  for (int calls = 0; !pos_sorted || !depth_sorted; ++calls) {
+    CHECK(calls < 100000);
+    if (!pos_sorted) {
+      pos_sorted = reg.sort_rows<Pos>(key_of, std::chrono::microseconds(0));
+    }
+    if (!depth_sorted) {
+      depth_sorted =
+          reg.sort_rows<Depth>(depth_of, std::chrono::microseconds(0));
+    }
+  }
+  check_sorted(&reg, N);
+  std::uint32_t last = 0;
+  reg.query<const Depth&>().each([&last](const Depth& d) {
+    CHECK(d.z >= last);
+    last = d.z;
+  });
+}
+
+}  // namespace
+
+int main() {
+  test_sort_rows();
+  test_interleaved_sorts();
+}
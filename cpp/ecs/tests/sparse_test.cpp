@@ -0,0 +1,79 @@
+#include <vector>
+
+#include "registry.h"
+#include "t9/check.h"
+
+namespace {
+
+struct Pos {
+  int x = 0;
+};
+struct Burning {
+  int ticks = 0;
+};
+
+}  // namespace
+
+namespace ecs {
+
+template <>
+struct component_traits<Burning> {
+  static constexpr StorageType storage = StorageType::SparseSet;
+};
+
+}  // namespace ecs
+
+namespace {
+
+// toggling a sparse component while iterating leaves the rows in place.
+void test_toggle_while_iterating() {
+  ecs::Registry reg;
+  std::vector<ecs::EntityId> ids;
+  std::vector<const Pos*> rows;
+  for (int i = 0; i < 300; ++i) {
+    ids.emplace_back(reg.create_entity<Pos>());
+    reg.get_component<Pos>(ids.back())->x = i;
+    rows.emplace_back(reg.get_component<Pos>(ids.back()));
+  }
+  auto before = reg.stats();
+
+  for (int pass = 0; pass < 2; ++pass) {
+    int n = 0;
+    reg.query<ecs::EntityId, Pos>().each([&](ecs::EntityId id, Pos& pos) {
+      if (pos.x % 2 == pass) {
+        CHECK(reg.add_component<Burning>(id, Burning{pos.x}));
+      } else {
+        CHECK(reg.remove_component<Burning>(id) == (pass == 1));
+      }
+      ++n;
+    });
+    CHECK(n == 300);
+  }
+
+  auto after = reg.stats();
+  CHECK(after.archetype_count == before.archetype_count);
+  CHECK(after.chunk_count == before.chunk_count);
+  int burning = 0;
+  for (int i = 0; i < 300; ++i) {
+    CHECK(reg.get_component<Pos>(ids[i]) == rows[i]);
+    auto p = reg.get_component<Burning>(ids[i]);
+    CHECK((p != nullptr) == (i % 2 == 1));
+    if (p) {
+      CHECK(p->ticks == i);
+      ++burning;
+    }
+  }
+  CHECK(burning == 150);
+
+  int n = 0;
+  reg.query<const Pos, const Burning>().each(
+      [&](const Pos& pos, const Burning& b) {
+        CHECK(pos.x == b.ticks);
+        ++n;
+      });
+  CHECK(n == 150);
+}
+
+}  // namespace
+
+int main() { test_toggle_while_iterating(); }
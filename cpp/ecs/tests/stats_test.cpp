@@ -0,0 +1,69 @@
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "registry.h"
+#include "stats.h"
+#include "t9/check.h"
+
+namespace {
+
+struct Pos {
+  float x = 0;
+  float y = 0;
+};
+struct Vel {
+  char dx = 0;
+};
+
+// occupancy, counts and memory of a registry with holes.
+void test_stats() {
+  ecs::Registry reg;
+  CHECK(reg.stats().occupancy() == 0.0);
+
+  std::vector<ecs::EntityId> ids;
+  for (int i = 0; i < 100; ++i) {
+    ids.emplace_back(reg.create_entity<Pos>());
+  }
+  reg.create_entity<Pos, Vel>();
+  for (int i = 0; i < 100; i += 4) {
+    reg.destroy_entity(ids[i]);
+  }
+
+  auto stats = reg.stats();
+  CHECK(stats.archetype_count == 2);
+  CHECK(stats.archetypes.size() == 2);
+  CHECK(stats.live_rows == 76);
+  CHECK(stats.entity_count == 76);
+  CHECK(stats.free_index_count == 25);
+  CHECK(stats.capacity >= stats.live_rows);
+  CHECK(stats.occupancy() > 0.0 && stats.occupancy() <= 1.0);
+
+  std::size_t chunk_count = 0;
+  std::size_t memory_size = 0;
+  for (auto& a : stats.archetypes) {
+    CHECK(a.chunk_count >= 1);
+    CHECK(a.capacity % a.chunk_count == 0);
+    CHECK(a.row_size * (a.capacity / a.chunk_count) <= a.chunk_size);
+    CHECK(a.row_padding < a.row_size);
+    chunk_count += a.chunk_count;
+    memory_size += a.memory_size;
+  }
+  CHECK(stats.chunk_count == chunk_count);
+  CHECK(stats.memory_size > memory_size);
+  // EntityId, Pos and Vel pad the row.
+  auto padded = stats.archetypes[0].type_count == 3 ? stats.archetypes[0]
+                                                    : stats.archetypes[1];
+  CHECK(padded.row_padding > 0);
+  CHECK(stats.padding_size == padded.row_padding);
+
+  std::ostringstream out;
+  ecs::write_json(out, stats);
+  auto json = out.str();
+  CHECK(json.find("\"live_rows\":76") != std::string::npos);
+  CHECK(json.find("\"archetypes\":[{") != std::string::npos);
+}
+
+}  // namespace
+
+int main() { test_stats(); }
@@ -1,6 +1,7 @@
 #pragma once
 #include <cassert>
 #include <cstddef>
+#include <cstring>
 #include <memory>
 
 #include "type.h"
@@ -8,6 +9,9 @@
 namespace ecs {
 
 class Tuple {
+ public:
+  static constexpr std::size_t NPOS = static_cast<std::size_t>(-1);
+
  private:
   Tuple(const Tuple&) = delete;
   Tuple(Tuple&&) = delete;
@@ -18,32 +22,44 @@ class Tuple {
   struct Element {
     const Type* type = nullptr;
     std::size_t offset = 0;
+    std::size_t enable_index = NPOS;
   };
 
  private:
   std::unique_ptr<Element[]> types_;
   std::size_t type_size_ = 0;
+  std::size_t enableable_size_ = 0;
+  std::size_t data_size_ = 0;
   std::size_t memory_size_ = 0;
+  std::size_t align_ = 1;
+  bool is_trivially_copyable_ = true;
+  bool is_movable_ = true;
 
  private:
-  template <std::size_t N>
-  Tuple(const Type* (&types)[N])
-      : types_(std::make_unique<Element[]>(N)), type_size_(N) {
+  Tuple(const Type* const* types, std::size_t n)
+      : types_(std::make_unique<Element[]>(n)), type_size_(n) {
     const auto fix_align = [](std::size_t offset, std::size_t align) {
       auto r = offset % align;
       return r == 0 ? offset : offset + align - r;
     };
     size_t offset = 0;
     size_t align = 0;
-    for (std::size_t i = 0; i < N; ++i) {
+    for (std::size_t i = 0; i < n; ++i) {
       offset = fix_align(offset, types[i]->align);
       types_[i].type = types[i];
       types_[i].offset = offset;
+      if (types[i]->is_enableable) {
+        types_[i].enable_index = enableable_size_++;
+      }
       offset += types[i]->size;
+      data_size_ += types[i]->size;
+      is_trivially_copyable_ &= types[i]->is_trivially_copyable;
+      is_movable_ &= types[i]->move != nullptr;
       align = std::max(align, types[i]->align);
     }
     offset = fix_align(offset, align);
     memory_size_ = offset;
+    align_ = align;
   }
 
  public:
@@ -60,10 +76,86 @@ class Tuple {
     }
   }
 
+  void move_construct(void* dst, void* src) const {
+    assert(is_movable_ && "tuple is not move constructible.");
+    auto dst_top = reinterpret_cast<std::uint8_t*>(dst);
+    auto src_top = reinterpret_cast<std::uint8_t*>(src);
+    for (std::size_t i = 0; i < type_size_; ++i) {
+      auto offset = types_[i].offset;
+      types_[i].type->move(dst_top + offset, src_top + offset);
+    }
+  }
+
+  void copy_construct(void* dst, const void* src) const {
+    if (is_trivially_copyable_) {
+      std::memcpy(dst, src, memory_size_);
+      return;
+    }
+    auto dst_top = reinterpret_cast<std::uint8_t*>(dst);
+    auto src_top = reinterpret_cast<const std::uint8_t*>(src);
+    for (std::size_t i = 0; i < type_size_; ++i) {
+      auto type = types_[i].type;
+      auto offset = types_[i].offset;
+      if (type->is_trivially_copyable) {
+        std::memcpy(dst_top + offset, src_top + offset, type->size);
+      } else {
+        assert(type->copy && "type is not copy constructible.");
+        type->copy(dst_top + offset, src_top + offset);
+      }
+    }
+  }
+
+  // whether the types shared with |src_tuple| are move constructible.
+  bool can_migrate_from(const Tuple* src_tuple) const {
+    if (is_movable_ || src_tuple->is_movable_) return true;
+    for (std::size_t i = 0, j = 0;
+         i < type_size_ && j < src_tuple->type_size_;) {
+      auto dst_type = types_[i].type;
+      auto src_type = src_tuple->types_[j].type;
+      if (type_less(dst_type, src_type)) {
+        ++i;
+      } else if (type_less(src_type, dst_type)) {
+        ++j;
+      } else {
+        if (!dst_type->move) return false;
+        ++i;
+        ++j;
+      }
+    }
+    return true;
+  }
+
+  // construct a row from a row of |src_tuple|. shared types are moved,
+  // the others are default constructed, and the |src| row is destructed.
+  void migrate_construct(void* dst, const Tuple* src_tuple, void* src) const {
+    assert(can_migrate_from(src_tuple) && "shared type is not movable.");
+    auto dst_top = reinterpret_cast<std::uint8_t*>(dst);
+    auto src_top = reinterpret_cast<std::uint8_t*>(src);
+    std::size_t i = 0, j = 0;
+    while (i < type_size_ || j < src_tuple->type_size_) {
+      auto dst_e = i < type_size_ ? &types_[i] : nullptr;
+      auto src_e = j < src_tuple->type_size_ ? &src_tuple->types_[j] : nullptr;
+      if (!src_e || (dst_e && type_less(dst_e->type, src_e->type))) {
+        dst_e->type->ctor(dst_top + dst_e->offset);
+        ++i;
+      } else if (!dst_e || type_less(src_e->type, dst_e->type)) {
+        src_e->type->dtor(src_top + src_e->offset);
+        ++j;
+      } else {
+        dst_e->type->move(dst_top + dst_e->offset, src_top + src_e->offset);
+        src_e->type->dtor(src_top + src_e->offset);
+        ++i;
+        ++j;
+      }
+    }
+  }
+
   template <typename T>
   bool try_get_offset(std::size_t* out_offset) const {
+    return try_get_offset(Type::get<T>(), out_offset);
+  }
+  bool try_get_offset(const Type* type, std::size_t* out_offset) const {
     assert(out_offset);
-    auto type = Type::get<T>();
     for (std::size_t i = 0; i < type_size_; ++i) {
       if (types_[i].type == type) {
         *out_offset = types_[i].offset;
@@ -73,26 +165,42 @@ class Tuple {
     return false;
   }
 
+  // index of the enabled bits of |type|, or NPOS if not enableable.
+  std::size_t enable_index(const Type* type) const {
+    for (std::size_t i = 0; i < type_size_; ++i) {
+      if (types_[i].type == type) return types_[i].enable_index;
+    }
+    return NPOS;
+  }
+  std::size_t enable_index_at(std::size_t i) const {
+    return types_[i].enable_index;
+  }
+
+  std::size_t type_size() const { return type_size_; }
+  std::size_t enableable_size() const { return enableable_size_; }
+  const Type* type(std::size_t i) const { return types_[i].type; }
+  std::size_t offset(std::size_t i) const { return types_[i].offset; }
   std::size_t memory_size() const { return memory_size_; }
+  std::size_t padding_size() const { return memory_size_ - data_size_; }
+  std::size_t align() const { return align_; }
+  bool is_movable() const { return is_movable_; }
 
-  template <typename... Ts>
-  bool is_match() const {
-    std::size_t n = sizeof...(Ts);
+  bool is_match(const Type* const* types, std::size_t n) const {
     if (type_size_ != n) return false;
-    const Type* types[] = {Type::get<sanitalize_t<Ts>>()...};
-    sort_type_array(types);
     for (std::size_t i = 0; i < n; ++i) {
       if (types_[i].type != types[i]) return false;
     }
-    return false;
+    return true;
   }
-
   template <typename... Ts>
-  bool contains() const {
-    std::size_t n = sizeof...(Ts);
+  bool is_match() const {
+    auto types = make_type_array<Ts...>();
+    return is_match(types.data(), types.size());
+  }
+
+  bool contains(const Type* const* types, std::size_t n) const {
+    if (n == 0) return true;
     if (type_size_ < n) return false;
-    const Type* types[] = {Type::get<sanitalize_t<Ts>>()...};
-    sort_type_array(types);
     for (std::size_t i = 0, j = 0; i < type_size_; ++i) {
       if (types_[i].type == types[j]) {
         if (++j == n) return true;
@@ -100,12 +208,22 @@ class Tuple {
     }
     return false;
   }
+  template <typename... Ts>
+  bool contains() const {
+    auto types = make_type_array<Ts...>();
+    return contains(types.data(), types.size());
+  }
 
+  static std::unique_ptr<Tuple> make(const Type* const* types, std::size_t n) {
+    std::unique_ptr<const Type*[]> sorted(new const Type*[n]);
+    std::copy(types, types + n, sorted.get());
+    std::sort(sorted.get(), sorted.get() + n, type_less);
+    return std::unique_ptr<Tuple>(new Tuple(sorted.get(), n));
+  }
   template <class... Ts>
   static std::unique_ptr<Tuple> make() {
-    const Type* types[] = {Type::get<sanitalize_t<Ts>>()...};
-    sort_type_array(types);
-    return std::unique_ptr<Tuple>(new Tuple(types));
+    auto types = make_type_array<Ts...>();
+    return std::unique_ptr<Tuple>(new Tuple(types.data(), types.size()));
   }
 };
 
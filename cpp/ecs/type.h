@@ -1,12 +1,19 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <cassert>
 #include <cstddef>
 #include <cstdint>
 #include <iterator>
 #include <memory>
+#include <mutex>
 #include <new>
 #include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "component.h"
 
 namespace ecs {
 
@@ -14,12 +21,18 @@ struct Type {
   using Id = std::uintptr_t;
   using CtorFunc = void (*)(void*);
   using DtorFunc = void (*)(void*);
+  using MoveFunc = void (*)(void*, void*);
+  using CopyFunc = void (*)(void*, const void*);
 
   Id id = 0;
   std::size_t size = 0;
   std::size_t align = 0;
   CtorFunc ctor = nullptr;
   DtorFunc dtor = nullptr;
+  MoveFunc move = nullptr;
+  CopyFunc copy = nullptr;
+  bool is_trivially_copyable = false;
+  bool is_enableable = false;
 
   template <typename T>
   static Id type2id() {
@@ -27,6 +40,28 @@ struct Type {
     return reinterpret_cast<Id>(&i);
   }
 
+  template <typename T>
+  static CopyFunc copy_func() {
+    if constexpr (std::is_copy_constructible_v<T>) {
+      return [](void* dst, const void* src) {
+        new (dst) T(*static_cast<const T*>(src));
+      };
+    } else {
+      return nullptr;
+    }
+  }
+
+  template <typename T>
+  static MoveFunc move_func() {
+    if constexpr (std::is_move_constructible_v<T>) {
+      return [](void* dst, void* src) {
+        new (dst) T(std::move(*static_cast<T*>(src)));
+      };
+    } else {
+      return nullptr;
+    }
+  }
+
   template <typename T>
   static const Type* get() {
     static const Type type = {
@@ -35,22 +70,60 @@ struct Type {
         alignof(T),
         [](void* p) { new (p) T; },
         [](void* p) { std::destroy_at(static_cast<T*>(p)); },
+        move_func<T>(),
+        copy_func<T>(),
+        std::is_trivially_copyable_v<T>,
+        is_enableable_v<T>,
     };
     return &type;
   }
+
+  // a type described at runtime, for components without a C++ type.
+  // it lives as long as the program, like the types of get().
+  // |move| and |copy| may be null: rows of such types stay where they are.
+  static const Type* make(std::size_t size, std::size_t align, CtorFunc ctor,
+                          DtorFunc dtor, MoveFunc move, CopyFunc copy,
+                          bool is_trivially_copyable = false) {
+    assert(size > 0 && align > 0 && (align & (align - 1)) == 0);
+    assert(ctor && dtor);
+    assert((copy || !is_trivially_copyable) &&
+           "trivially copyable types are copy constructible.");
+    static std::mutex mutex;
+    static std::vector<std::unique_ptr<Type>> types;
+    auto type = std::make_unique<Type>();
+    type->id = reinterpret_cast<Id>(type.get());
+    type->size = size;
+    type->align = align;
+    type->ctor = ctor;
+    type->dtor = dtor;
+    type->move = move;
+    type->copy = copy;
+    type->is_trivially_copyable = is_trivially_copyable;
+    std::lock_guard<std::mutex> lock(mutex);
+    return types.emplace_back(std::move(type)).get();
+  }
 };
 
+inline bool type_less(const Type* lhs, const Type* rhs) {
+  if (lhs->size < rhs->size) return false;
+  if (lhs->size > rhs->size) return true;
+  return lhs->id < rhs->id;
+}
+
 template <typename... Ts, std::size_t N>
 inline void sort_type_array(const Type* (&types)[N]) {
-  std::sort(std::begin(types), std::end(types),
-            [](const Type* lhs, const Type* rhs) {
-              if (lhs->size < rhs->size) return false;
-              if (lhs->size > rhs->size) return true;
-              return lhs->id < rhs->id;
-            });
+  std::sort(std::begin(types), std::end(types), type_less);
 }
 
 template <typename T>
 using sanitalize_t = std::remove_const_t<std::remove_reference_t<T>>;
 
+template <typename... Ts>
+inline std::array<const Type*, sizeof...(Ts)> make_type_array() {
+  std::array<const Type*, sizeof...(Ts)> types = {
+      Type::get<sanitalize_t<Ts>>()...};
+  std::sort(types.begin(), types.end(), type_less);
+  return types;
+}
+
 }  // namespace ecs
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+
+// CHECK.
+// unlike assert, also checks in release builds.
+#define CHECK(x)                                                      \
+  do {                                                                \
+    if (!(x)) {                                                       \
+      std::fprintf(stderr, "%s:%d: CHECK(%s)\n", __FILE__, __LINE__, #x); \
+      std::abort();                                                   \
+    }                                                                 \
+  } while (0)
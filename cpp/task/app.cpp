@@ -3,6 +3,7 @@
 #include <cassert>
 
 #include "job.h"
+#include "profiler.h"
 #include "scheduler.h"
 
 namespace task {
@@ -21,6 +22,9 @@ App::App() {
 void App::update() {
   auto scheduler = context.get<Scheduler>();
   scheduler->run(context);
+  if (auto profiler = context.get<Profiler>()) {
+    profiler->next_frame();
+  }
 }
 
 bool App::run() {
@@ -35,20 +39,37 @@ bool App::run() {
 
 bool App::setup_() {
   std::size_t thread_n = std::thread::hardware_concurrency();
+  std::vector<int> cpus;
   if (auto settings = context.get<JobSettings>()) {
     thread_n = settings->thread_n;
+    cpus = settings->cpus;
   }
   auto executor = context.get<JobExecutor>();
   assert(executor);
-  if (!executor->start(thread_n)) return false;
+  if (auto profiler = context.get<Profiler>()) {
+    // the workers and the thread in join().
+    profiler->reserve_threads(thread_n + 1);
+    executor->set_observer(profiler);
+  }
+  if (!executor->start(thread_n, cpus)) return false;
 
   if (auto scheduler = context.get<Scheduler>()) {
     scheduler->setup_task_dependencies();
+    executor->reserve(scheduler->task_count());
   }
 
   return true;
 }
 
+void App::set_pipelined_(PhaseId present_phase_id) {
+  auto scheduler = context.get<Scheduler>();
+  scheduler->set_pipelined(present_phase_id);
+}
+void App::add_advance_func_(std::function<void(std::size_t)> f) {
+  auto scheduler = context.get<Scheduler>();
+  scheduler->add_advance_func(std::move(f));
+}
+
 bool App::add_phase_(std::unique_ptr<PhaseData> p) {
   auto scheduler = context.get<Scheduler>();
   return scheduler->add_phase(std::move(p));
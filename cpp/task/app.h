@@ -2,9 +2,12 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "context.h"
 #include "event.h"
+#include "frame.h"
+#include "parallel.h"
 #include "phase.h"
 #include "t9/func_traits.h"
 #include "task.h"
@@ -21,6 +24,8 @@ struct LastPhase;
 // JobSettings.
 struct JobSettings {
   std::size_t thread_n = 0;
+  // cpu of each worker in turn, none to leave them unpinned.
+  std::vector<int> cpus;
 };
 
 // App.
@@ -57,6 +62,23 @@ class App {
                                   [](Event<T>* e) { e->update(); });
   }
 
+  // a resource that tasks reach through Frame<T>.
+  template <typename T, typename... Args>
+  FrameBuffer<T>* add_frame_resource(Args&&... args) {
+    auto buffer =
+        context.add_with<FrameBuffer<T>>(std::forward<Args>(args)...);
+    if (!buffer) return nullptr;
+    add_advance_func_([buffer](std::size_t frame) { buffer->advance(frame); });
+    return buffer;
+  }
+
+  // present a frame from PresentPhaseT on, while the phases before it
+  // simulate the next frame. call before run().
+  template <typename PresentPhaseT = LastPhase>
+  void set_pipelined() {
+    set_pipelined_(Phase<PresentPhaseT>::id);
+  }
+
   template <typename T>
   bool add_phase(std::string_view name) {
     auto phase = make_phase<T>(name);
@@ -73,6 +95,11 @@ class App {
     using args_type = typename t9::func_traits<F>::args_type;
     return add_task_in_phase_(Phase<PhaseT>::id, name, f, args_type{});
   }
+  template <typename PhaseT, typename SizeF, typename F>
+  bool add_task_in_phase(std::string_view name, ParallelFor<SizeF, F> f) {
+    auto task = make_parallel_for_task(name, std::move(f));
+    return add_task_in_phase_(Phase<PhaseT>::id, std::move(task));
+  }
   template <typename F>
   bool add_task(std::string_view name, F f) {
     return add_task_in_phase<UpdatePhase>(name, f);
@@ -81,13 +108,16 @@ class App {
  private:
   bool setup_();
 
+  void set_pipelined_(PhaseId present_phase_id);
+  void add_advance_func_(std::function<void(std::size_t)> f);
+
   bool add_phase_(std::unique_ptr<PhaseData> p);
   bool insert_phase_(PhaseId next_phase_id, std::unique_ptr<PhaseData> p);
 
   template <typename F, typename... Ts>
   bool add_task_in_phase_(PhaseId phase_id, std::string_view name, F f,
                           t9::type_list<Ts...>) {
-    auto task = std::make_shared<FuncTask<Ts...>>(name, f);
+    auto task = std::make_shared<FuncTask<F, Ts...>>(name, std::move(f));
     return add_task_in_phase_(phase_id, std::move(task));
   }
   bool add_task_in_phase_(PhaseId phase_id, std::shared_ptr<Task> task);
@@ -0,0 +1,78 @@
+#pragma once
+#include <array>
+#include <cassert>
+#include <type_traits>
+#include <utility>
+
+#include "task_traits.h"
+#include "task_work.h"
+
+namespace task {
+
+// FrameBuffer.
+// a resource with one copy per frame in flight. when frames are
+// pipelined, the next frame is simulated into one copy while the current
+// one is presented from the other.
+template <typename T>
+class FrameBuffer {
+ public:
+  static constexpr std::size_t FRAME_N = 2;
+
+ private:
+  std::array<T, FRAME_N> buffers_;
+
+ public:
+  template <class... Args>
+  explicit FrameBuffer(Args&&... args) {
+    buffers_[0] = T(std::forward<Args>(args)...);
+    for (std::size_t i = 1; i < FRAME_N; ++i) {
+      buffers_[i] = buffers_[0];
+    }
+  }
+
+  // start |frame| from the state of the frame before it.
+  void advance(std::size_t frame) {
+    buffers_[frame % FRAME_N] = buffers_[(frame + FRAME_N - 1) % FRAME_N];
+  }
+
+  T* at(std::size_t frame) { return &buffers_[frame % FRAME_N]; }
+  const T* at(std::size_t frame) const { return &buffers_[frame % FRAME_N]; }
+};
+
+// Frame.
+// the copy of a FrameBuffer<T> that belongs to the frame of the task.
+template <typename T>
+struct Frame {
+  T* x = nullptr;
+
+  T* operator->() const { return x; }
+  T& operator*() const { return *x; }
+};
+
+// task_traits.
+template <typename T>
+struct task_traits<Frame<T>> {
+  static void set_permission(TaskPermission* permission) {
+    permission->set_write<FrameBuffer<T>>();
+    permission->set_buffered<FrameBuffer<T>>();
+  }
+  static Frame<T> apply_args(const Context* ctx, TaskWork* work) {
+    auto buffer = ctx->get<FrameBuffer<T>>();
+    assert(buffer);
+    return Frame<T>{buffer->at(work->frame())};
+  }
+};
+template <typename T>
+struct task_traits<Frame<const T>> {
+  static void set_permission(TaskPermission* permission) {
+    permission->set_read<FrameBuffer<T>>();
+    permission->set_buffered<FrameBuffer<T>>();
+  }
+  static Frame<const T> apply_args(const Context* ctx, TaskWork* work) {
+    auto buffer = ctx->get<FrameBuffer<T>>();
+    assert(buffer);
+    return Frame<const T>{buffer->at(work->frame())};
+  }
+};
+
+}  // namespace task
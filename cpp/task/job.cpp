@@ -2,6 +2,11 @@
 
 #include <algorithm>
 
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 namespace task {
 
 // Job.
@@ -17,6 +22,17 @@ void Job::exec() {
   }
 }
 
+void Job::add_successor(Job* job) {
+  successors_.emplace_back(job);
+  ++job->predecessor_count_;
+  ++job->wait_count_;
+}
+void Job::clear_links() {
+  successors_.clear();
+  predecessor_count_ = 0;
+  wait_count_ = 1;
+}
+
 bool Job::change_state(State state) {
   if (state_ == state) return true;
   bool is_ok = false;
@@ -39,79 +55,228 @@ bool Job::change_state(State state) {
   }
   return is_ok;
 }
+bool Job::reset_state() {
+  if (!change_state(State::None)) return false;
+  wait_count_ = predecessor_count_ + 1;
+  return true;
+}
+
+namespace {
+
+// the executor and deque of the current thread.
+thread_local const JobExecutor* tls_executor = nullptr;
+thread_local std::size_t tls_deque_index = 0;
+
+bool pin_thread(std::thread& t, int cpu) {
+#if defined(__linux__)
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(cpu, &cpus);
+  return pthread_setaffinity_np(t.native_handle(), sizeof(cpus), &cpus) == 0;
+#else
+  (void)t;
+  (void)cpu;
+  return false;
+#endif
+}
+
+}  // namespace
 
 // JobExecutor.
 /*virtual*/ JobExecutor::~JobExecutor() { stop(); }
 
-bool JobExecutor::start(std::size_t thread_n) {
+bool JobExecutor::start(std::size_t thread_n, const std::vector<int>& cpus) {
+  deques_.resize(thread_n + 1);
+  for (auto& deque : deques_) {
+    deque = std::make_unique<JobDeque>();
+  }
+  tls_executor = this;
+  tls_deque_index = thread_n;
   threads_.resize(thread_n);
   for (std::size_t i = 0; i < thread_n; ++i) {
-    std::thread t([this]() { exec_jobs_(); });
+    std::thread t([this, i]() { exec_jobs_(i); });
     threads_[i] = std::move(t);
   }
-  return true;
+  bool is_ok = true;
+  for (std::size_t i = 0; i < thread_n && !cpus.empty(); ++i) {
+    is_ok &= pin_thread(threads_[i], cpus[i % cpus.size()]);
+  }
+  return is_ok;
 }
 void JobExecutor::stop() {
   is_stop_ = true;
-  condition_.notify_all();
+  {
+    std::unique_lock lock(mutex_);
+    condition_.notify_all();
+  }
   std::for_each(threads_.begin(), threads_.end(), [](auto& t) { t.join(); });
   threads_.clear();
-  jobs_.clear();
+  deques_.clear();
+  while (injection_.pop()) {
+  }
+  while (main_jobs_.pop()) {
+  }
+  pending_job_count_ = 0;
+  if (tls_executor == this) {
+    tls_executor = nullptr;
+  }
   is_stop_ = false;
 }
 
-void JobExecutor::submit(std::shared_ptr<Job> job) {
-  std::unique_lock lock(mutex_);
+void JobExecutor::reserve(std::size_t job_n) {
+  for (auto& deque : deques_) {
+    deque->reserve(job_n);
+  }
+}
+
+void JobExecutor::submit(Job* job) {
   job->set_observer(this);
-  jobs_.emplace_back(std::move(job));
+  ++pending_job_count_;
+  if (job->release()) {
+    enqueue_(job);
+  }
 }
-void JobExecutor::kick() { condition_.notify_all(); }
+void JobExecutor::kick() { wake_all_(); }
 void JobExecutor::join() {
-  do {
-    std::shared_ptr<Job> job;
-    {
-      std::unique_lock lock(mutex_);
-      bool is_done = jobs_.empty() && active_job_count_ == 0;
-      if (is_done) break;
-      auto it = std::find_if(jobs_.begin(), jobs_.end(),
-                             [](auto& job) { return job->can_exec(); });
-      if (it == jobs_.end()) {
-        condition_.wait(lock);
-        continue;
-      }
-      job = *it;
-      jobs_.erase(it);
-      ++active_job_count_;
+  auto index = deque_index_();
+  std::size_t spin = 0;
+  while (pending_job_count_.load() > 0) {
+    if (auto job = find_job_(index, true)) {
+      exec_job_(job);
+      spin = 0;
+      continue;
     }
-    job->exec();
-  } while (true);
+    if (++spin < SPIN_N) {
+      std::this_thread::yield();
+      continue;
+    }
+    spin = 0;
+    std::unique_lock lock(mutex_);
+    ++sleeper_count_;
+    if (pending_job_count_.load() > 0 && !has_job_(true)) {
+      condition_.wait(lock);
+    }
+    --sleeper_count_;
+  }
 }
 
-/*virtual*/ void JobExecutor::on_pre_exec_job(Job* /*job*/) /*override*/ {}
-/*virtual*/ void JobExecutor::on_post_exec_job(Job* /*job*/) /*override*/ {
-  std::unique_lock lock(mutex_);
-  --active_job_count_;
-  condition_.notify_all();
+/*virtual*/ void JobExecutor::on_pre_exec_job(Job* job) /*override*/ {
+  if (observer_) {
+    observer_->on_pre_exec_job(job);
+  }
+}
+/*virtual*/ void JobExecutor::on_post_exec_job(Job* job) /*override*/ {
+  if (observer_) {
+    observer_->on_post_exec_job(job);
+  }
+}
+
+void JobExecutor::exec_jobs_(std::size_t index) {
+  tls_executor = this;
+  tls_deque_index = index;
+  std::size_t spin = 0;
+  while (!is_stop_.load()) {
+    if (auto job = find_job_(index, false)) {
+      exec_job_(job);
+      spin = 0;
+      continue;
+    }
+    if (++spin < SPIN_N) {
+      std::this_thread::yield();
+      continue;
+    }
+    spin = 0;
+    std::unique_lock lock(mutex_);
+    ++sleeper_count_;
+    if (!is_stop_.load() && !has_job_(false)) {
+      condition_.wait(lock);
+    }
+    --sleeper_count_;
+  }
+}
+
+std::size_t JobExecutor::deque_index_() const {
+  return tls_executor == this ? tls_deque_index : NPOS;
+}
+
+void JobExecutor::push_(Job* job) {
+  auto index = deque_index_();
+  if (index != NPOS) {
+    deques_[index]->push(job);
+    return;
+  }
+  while (!injection_.push(job)) {
+    std::this_thread::yield();
+  }
+}
+
+void JobExecutor::enqueue_(Job* job) {
+  if (!job->is_main_thread()) {
+    push_(job);
+    wake_one_();
+    return;
+  }
+  while (!main_jobs_.push(job)) {
+    std::this_thread::yield();
+  }
+  // the thread in join() may be any of the sleepers.
+  wake_all_();
+}
+
+// main thread jobs first if joining, then the own deque, the shared
+// queue, and steal from the others.
+Job* JobExecutor::find_job_(std::size_t index, bool is_join) {
+  if (is_join) {
+    if (auto job = main_jobs_.pop()) return job;
+  }
+  if (index != NPOS) {
+    if (auto job = deques_[index]->pop()) return job;
+  }
+  if (auto job = injection_.pop()) return job;
+  auto n = deques_.size();
+  auto first = index != NPOS ? index + 1 : 0;
+  for (std::size_t i = 0; i < n; ++i) {
+    auto victim = (first + i) % n;
+    if (victim == index) continue;
+    if (auto job = deques_[victim]->steal()) return job;
+  }
+  return nullptr;
 }
 
-void JobExecutor::exec_jobs_() {
-  while (!is_stop_) {
-    std::shared_ptr<Job> job;
-    {
-      std::unique_lock lock(mutex_);
-      auto it = std::find_if(jobs_.begin(), jobs_.end(),
-                             [](auto& job) { return job->can_exec(); });
-      if (it == jobs_.end()) {
-        if (is_stop_) continue;
-        condition_.wait(lock);
-        continue;
-      }
-      job = *it;
-      jobs_.erase(it);
-      ++active_job_count_;
+// run |job| and push the successors it made ready. the job counts as
+// pending until then, so join() does not return while they are touched.
+void JobExecutor::exec_job_(Job* job) {
+  job->exec();
+  for (auto successor : job->successors()) {
+    if (successor->release()) {
+      enqueue_(successor);
     }
-    job->exec();
   }
+  if (--pending_job_count_ == 0) {
+    wake_all_();
+  }
+}
+
+bool JobExecutor::has_job_(bool is_join) const {
+  if (is_join && !main_jobs_.empty()) return true;
+  if (!injection_.empty()) return true;
+  return std::any_of(deques_.begin(), deques_.end(),
+                     [](auto& deque) { return !deque->empty(); });
+}
+
+// a sleeper bumps sleeper_count_ before it checks for jobs, so either it
+// sees the new job or we see it and wake it under the mutex.
+void JobExecutor::wake_one_() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleeper_count_.load() == 0) return;
+  std::unique_lock lock(mutex_);
+  condition_.notify_one();
+}
+void JobExecutor::wake_all_() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleeper_count_.load() == 0) return;
+  std::unique_lock lock(mutex_);
+  condition_.notify_all();
 }
 
-}  // namespace task
\ No newline at end of file
+}  // namespace task
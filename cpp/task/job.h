@@ -1,12 +1,13 @@
 #pragma once
+#include <atomic>
 #include <condition_variable>
-#include <deque>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
 #include <vector>
 
+#include "job_queue.h"
 #include "t9/noncopyable.h"
 
 namespace task {
@@ -33,45 +34,88 @@ class Job {
 
  private:
   std::string name_;
-  State state_ = State::None;
+  std::atomic<State> state_ = State::None;
   JobObserver* observer_ = nullptr;
+  bool is_main_thread_ = false;
+  std::vector<Job*> successors_;
+  std::size_t predecessor_count_ = 0;
+  // predecessors not done yet, plus one until submitted.
+  std::atomic<std::size_t> wait_count_ = 1;
 
  public:
   explicit Job(std::string_view name) : name_(name) {}
   virtual ~Job() = default;
 
-  bool can_exec() const { return on_can_exec(); }
   void exec();
 
+  // |job| waits for this job.
+  void add_successor(Job* job);
+  // drop every edge from and to this job, clear them on all jobs at once.
+  void clear_links();
+  const std::vector<Job*>& successors() const { return successors_; }
+  std::size_t predecessor_count() const { return predecessor_count_; }
+  // true if this job has no more reason to wait.
+  bool release() { return --wait_count_ == 0; }
+
   bool change_state(State state);
-  bool reset_state() { return change_state(State::None); }
+  bool reset_state();
   bool is_state(State state) const { return state_ == state; }
   std::string_view name() const { return name_; }
+  // the job this one does part of, e.g. the task of a helper.
+  virtual const Job* owner() const { return nullptr; }
 
   void set_observer(JobObserver* observer) { observer_ = observer; }
 
+  // run only by the thread in JobExecutor::join().
+  void set_main_thread(bool is_main_thread) {
+    is_main_thread_ = is_main_thread;
+  }
+  bool is_main_thread() const { return is_main_thread_; }
+
  protected:
-  virtual bool on_can_exec() const { return true; }
   virtual void on_exec() = 0;
 };
 
 // JobExecutor.
+// each worker owns a deque and steals from the others when it runs dry.
+// the thread that called start() owns one more deque and helps in join().
+// other threads submit through a shared queue. only ready jobs are queued;
+// a finished job queues the successors it released. main thread jobs wait
+// in their own queue for the thread in join(). the mutex is only taken to
+// sleep and wake idle threads.
 class JobExecutor : private t9::NonCopyable, public JobObserver {
+ private:
+  static constexpr std::size_t NPOS = static_cast<std::size_t>(-1);
+  static constexpr std::size_t SPIN_N = 64;
+
  private:
   std::vector<std::thread> threads_;
-  std::deque<std::shared_ptr<Job>> jobs_;
-  std::size_t active_job_count_ = 0;
+  std::vector<std::unique_ptr<JobDeque>> deques_;
+  JobQueue injection_;
+  JobQueue main_jobs_;
+  std::atomic<std::size_t> pending_job_count_ = 0;
+  std::atomic<std::size_t> sleeper_count_ = 0;
   std::mutex mutex_;
   std::condition_variable condition_;
-  volatile bool is_stop_ = false;
+  std::atomic<bool> is_stop_ = false;
+  JobObserver* observer_ = nullptr;
 
  public:
   virtual ~JobExecutor();
 
-  bool start(std::size_t thread_n);
+  // also told of every job, e.g. a Profiler. set while no job runs.
+  void set_observer(JobObserver* observer) { observer_ = observer; }
+
+  // pin worker i to cpus[i % cpus.size()], if any. false if it fails.
+  bool start(std::size_t thread_n, const std::vector<int>& cpus = {});
   void stop();
 
-  void submit(std::shared_ptr<Job> job);
+  // room for |job_n| jobs in every deque, so a frame does not grow them.
+  // call while no job runs.
+  void reserve(std::size_t job_n);
+
+  // the caller keeps |job| alive until join() returns.
+  void submit(Job* job);
   void kick();
   void join();
 
@@ -83,7 +127,16 @@ class JobExecutor : private t9::NonCopyable, public JobObserver {
   virtual void on_post_exec_job(Job* job) override;
 
  private:
-  void exec_jobs_();
+  void exec_jobs_(std::size_t index);
+
+  std::size_t deque_index_() const;
+  void push_(Job* job);
+  void enqueue_(Job* job);
+  Job* find_job_(std::size_t index, bool is_join);
+  void exec_job_(Job* job);
+  bool has_job_(bool is_join) const;
+  void wake_one_();
+  void wake_all_();
 };
 
 }  // namespace task
\ No newline at end of file
@@ -0,0 +1,208 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "t9/noncopyable.h"
+
+namespace task {
+
+class Job;
+
+// JobDeque.
+// Chase-Lev work-stealing deque. only the owner thread may push() and
+// pop() at the bottom; any thread may steal() from the top. grown buffers
+// are retired, not freed, since a thief may still be reading them.
+class JobDeque : private t9::NonCopyable {
+ private:
+  struct Buffer {
+    std::size_t mask = 0;
+    std::unique_ptr<std::atomic<Job*>[]> slots;
+
+    explicit Buffer(std::size_t capacity)
+        : mask(capacity - 1),
+          slots(std::make_unique<std::atomic<Job*>[]>(capacity)) {}
+
+    std::size_t capacity() const { return mask + 1; }
+    Job* get(std::int64_t i) const {
+      return slots[i & mask].load(std::memory_order_relaxed);
+    }
+    void put(std::int64_t i, Job* job) {
+      slots[i & mask].store(job, std::memory_order_relaxed);
+    }
+  };
+
+ private:
+  alignas(64) std::atomic<std::int64_t> top_ = 0;
+  alignas(64) std::atomic<std::int64_t> bottom_ = 0;
+  std::atomic<Buffer*> buffer_ = nullptr;
+  std::vector<std::unique_ptr<Buffer>> buffers_;
+
+ public:
+  explicit JobDeque(std::size_t capacity = 256) {
+    assert((capacity & (capacity - 1)) == 0);
+    buffers_.emplace_back(std::make_unique<Buffer>(capacity));
+    buffer_.store(buffers_.back().get(), std::memory_order_relaxed);
+  }
+
+  void push(Job* job) {
+    auto b = bottom_.load(std::memory_order_relaxed);
+    auto t = top_.load(std::memory_order_acquire);
+    auto buffer = buffer_.load(std::memory_order_relaxed);
+    if (b - t > static_cast<std::int64_t>(buffer->capacity()) - 1) {
+      buffer = grow_(buffer, b, t);
+    }
+    buffer->put(b, job);
+    bottom_.store(b + 1, std::memory_order_release);
+  }
+
+  Job* pop() {
+    auto b = bottom_.load(std::memory_order_relaxed) - 1;
+    auto buffer = buffer_.load(std::memory_order_relaxed);
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto t = top_.load(std::memory_order_relaxed);
+    if (t > b) {
+      bottom_.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    auto job = buffer->get(b);
+    if (t == b) {
+      // last one, race against thieves.
+      if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                        std::memory_order_relaxed)) {
+        job = nullptr;
+      }
+      bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+  }
+
+  Job* steal() {
+    auto t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto b = bottom_.load(std::memory_order_acquire);
+    if (t >= b) return nullptr;
+    auto buffer = buffer_.load(std::memory_order_acquire);
+    auto job = buffer->get(t);
+    if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return job;
+  }
+
+  // the owner, or any thread while no job is pushed.
+  void reserve(std::size_t n) {
+    auto b = bottom_.load(std::memory_order_relaxed);
+    auto t = top_.load(std::memory_order_acquire);
+    auto buffer = buffer_.load(std::memory_order_relaxed);
+    while (buffer->capacity() < n) {
+      buffer = grow_(buffer, b, t);
+    }
+  }
+
+  bool empty() const {
+    auto t = top_.load(std::memory_order_seq_cst);
+    auto b = bottom_.load(std::memory_order_seq_cst);
+    return t >= b;
+  }
+
+ private:
+  Buffer* grow_(Buffer* buffer, std::int64_t b, std::int64_t t) {
+    auto next = std::make_unique<Buffer>(buffer->capacity() * 2);
+    for (auto i = t; i < b; ++i) {
+      next->put(i, buffer->get(i));
+    }
+    buffers_.emplace_back(std::move(next));
+    buffer = buffers_.back().get();
+    buffer_.store(buffer, std::memory_order_release);
+    return buffer;
+  }
+};
+
+// JobQueue.
+// bounded multi-producer multi-consumer queue, for jobs submitted from
+// threads that own no deque.
+class JobQueue : private t9::NonCopyable {
+ private:
+  struct Cell {
+    std::atomic<std::size_t> sequence = 0;
+    Job* job = nullptr;
+  };
+
+ private:
+  std::unique_ptr<Cell[]> cells_;
+  std::size_t mask_ = 0;
+  alignas(64) std::atomic<std::size_t> enqueue_pos_ = 0;
+  alignas(64) std::atomic<std::size_t> dequeue_pos_ = 0;
+
+ public:
+  explicit JobQueue(std::size_t capacity = 4096)
+      : cells_(std::make_unique<Cell[]>(capacity)), mask_(capacity - 1) {
+    assert((capacity & (capacity - 1)) == 0);
+    for (std::size_t i = 0; i < capacity; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  // false if full.
+  bool push(Job* job) {
+    auto pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Cell* cell = nullptr;
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      auto seq = cell->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::intptr_t>(seq) -
+                  static_cast<std::intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->job = job;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // nullptr if empty.
+  Job* pop() {
+    auto pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Cell* cell = nullptr;
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      auto seq = cell->sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::intptr_t>(seq) -
+                  static_cast<std::intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return nullptr;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    auto job = cell->job;
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return job;
+  }
+
+  bool empty() const {
+    return dequeue_pos_.load(std::memory_order_seq_cst) >=
+           enqueue_pos_.load(std::memory_order_seq_cst);
+  }
+};
+
+}  // namespace task
@@ -1,7 +1,7 @@
 #include <cstdlib>
 #include <iostream>
 #include <thread>
-#include <unordered_map>
+#include <map>
 
 #include "app.h"
 #include "scheduler.h"
@@ -20,31 +20,14 @@ void recv(task::EventReceiver<int> recv) {
 void count(int& i) { ++i; }
 
 void show_tasks(const task::PhaseData* phase) {
-  std::unordered_map<const task::Task*, int> task_depth;
-  int max_depth = 0;
+  std::multimap<std::size_t, const task::Task*> task_order;
   for (auto& task : phase->tasks()) {
-    int depth = 0;
-    if (!task->dependencies().empty()) {
-      for (auto& d_task : task->dependencies()) {
-        if (auto it = task_depth.find(d_task); it != task_depth.end()) {
-          depth = std::max(it->second + 1, depth);
-        }
-      }
-    }
-    max_depth = std::max(depth, max_depth);
-    task_depth.emplace(task.get(), depth);
-  }
-
-  std::unordered_multimap<int, const task::Task*> task_order;
-  task_order.clear();
-  for (auto it : task_depth) {
-    task_order.emplace(it.second, it.first);
+    task_order.emplace(task->level(), task.get());
   }
-
-  for (int i = 0; i <= max_depth; ++i) {
-    std::cout << i << ":\n";
-    auto range = task_order.equal_range(i);
-    for (auto it = range.first; it != range.second; ++it) {
+  for (auto it = task_order.begin(); it != task_order.end();) {
+    auto level = it->first;
+    std::cout << level << ":\n";
+    for (; it != task_order.end() && it->first == level; ++it) {
       std::cout << " [" << it->second->name() << "]" << std::endl;
     }
   }
@@ -0,0 +1,71 @@
+#include "parallel.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace task {
+
+// ParallelTask::Helper.
+/*virtual*/ void ParallelTask::Helper::on_exec() /*override*/ {
+  owner_->run_chunks_();
+}
+
+// ParallelTask.
+ParallelTask::ParallelTask(std::string_view name,
+                           const TaskPermission& permission,
+                           std::size_t grain)
+    : Task(name, permission), grain_(std::max<std::size_t>(grain, 1)) {}
+
+void ParallelTask::run_(const Context* ctx, std::size_t n, ChunkFunc f,
+                        void* data) {
+  if (n == 0) return;
+  auto executor = ctx ? ctx->get<JobExecutor>() : nullptr;
+  size_ = n;
+  next_ = 0;
+  done_ = 0;
+  chunk_func_ = f;
+  chunk_data_ = data;
+  split_n_ = executor ? executor->thread_count() + 1 : 1;
+  auto chunk_n = (n + grain_ - 1) / grain_;
+  auto helper_n = std::min(split_n_, chunk_n) - 1;
+  if (helpers_.size() < helper_n) {
+    auto helper_name = std::string(name()) + "/helper";
+    while (helpers_.size() < helper_n) {
+      helpers_.emplace_back(std::make_unique<Helper>(helper_name, this));
+    }
+  }
+  for (std::size_t i = 0; i < helper_n; ++i) {
+    helpers_[i]->reset_state();
+    executor->submit(helpers_[i].get());
+  }
+  run_chunks_();
+  // chunks taken by helpers may still be running.
+  while (done_.load(std::memory_order_acquire) < n) {
+    std::this_thread::yield();
+  }
+}
+
+void ParallelTask::run_chunks_() {
+  ParallelRange range;
+  while (next_chunk_(&range)) {
+    chunk_func_(chunk_data_, range);
+    done_.fetch_add(range.size(), std::memory_order_release);
+  }
+}
+
+// guided: a share of what is left, no smaller than the grain.
+bool ParallelTask::next_chunk_(ParallelRange* range) {
+  auto first = next_.load(std::memory_order_relaxed);
+  std::size_t last = 0;
+  do {
+    if (first >= size_) return false;
+    auto n = std::max(grain_, (size_ - first) / (split_n_ * 2));
+    last = std::min(size_, first + n);
+  } while (!next_.compare_exchange_weak(first, last,
+                                        std::memory_order_relaxed));
+  range->first = first;
+  range->last = last;
+  return true;
+}
+
+}  // namespace task
@@ -0,0 +1,171 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include "job.h"
+#include "t9/func_traits.h"
+#include "task.h"
+
+namespace task {
+
+// ParallelRange.
+// a chunk of indices [first, last).
+struct ParallelRange {
+  // iterator.
+  class iterator {
+   private:
+    std::size_t i_ = 0;
+
+   public:
+    explicit iterator(std::size_t i) : i_(i) {}
+    std::size_t operator*() const { return i_; }
+    iterator& operator++() {
+      ++i_;
+      return *this;
+    }
+    bool operator!=(const iterator& rhs) const { return i_ != rhs.i_; }
+  };
+
+  std::size_t first = 0;
+  std::size_t last = 0;
+
+  iterator begin() const { return iterator(first); }
+  iterator end() const { return iterator(last); }
+  std::size_t size() const { return last - first; }
+};
+
+// ParallelFor.
+// run func(range, args...) on chunks of [0, size_func(args...)).
+template <typename SizeF, typename F>
+struct ParallelFor {
+  SizeF size_func;
+  F func;
+  std::size_t grain = 1;
+};
+
+// parallel_for.
+template <typename SizeF, typename F,
+          typename = std::enable_if_t<!std::is_integral_v<SizeF>>>
+inline ParallelFor<SizeF, F> parallel_for(SizeF size_func, F func,
+                                          std::size_t grain = 1) {
+  return ParallelFor<SizeF, F>{std::move(size_func), std::move(func), grain};
+}
+template <typename F>
+inline auto parallel_for(std::size_t n, F func, std::size_t grain = 1) {
+  return parallel_for([n]() { return n; }, std::move(func), grain);
+}
+
+// parallel_for_each.
+// run func(x) on each element of the resource C.
+template <typename C, typename F>
+inline auto parallel_for_each(F func, std::size_t grain = 1) {
+  return parallel_for([](const C& c) { return c.size(); },
+                      [func](ParallelRange r, C* c) {
+                        for (auto i : r) {
+                          func((*c)[i]);
+                        }
+                      },
+                      grain);
+}
+
+// ParallelTask.
+// splits its work into chunks. helper jobs take chunks on other workers
+// while the task takes them itself, chunks shrink as the range runs out,
+// and the task returns only after every chunk is done, so successors see
+// the whole range.
+class ParallelTask : public Task {
+ private:
+  using ChunkFunc = void (*)(void*, ParallelRange);
+
+  // Helper.
+  // named "<task>/helper".
+  class Helper : public Job {
+   private:
+    ParallelTask* owner_ = nullptr;
+
+   public:
+    Helper(std::string_view name, ParallelTask* owner)
+        : Job(name), owner_(owner) {}
+
+    virtual const Job* owner() const override { return owner_; }
+
+   protected:
+    virtual void on_exec() override;
+  };
+
+ private:
+  std::vector<std::unique_ptr<Helper>> helpers_;
+  std::size_t grain_ = 1;
+  std::size_t size_ = 0;
+  std::size_t split_n_ = 1;
+  std::atomic<std::size_t> next_ = 0;
+  std::atomic<std::size_t> done_ = 0;
+  ChunkFunc chunk_func_ = nullptr;
+  void* chunk_data_ = nullptr;
+
+ public:
+  ParallelTask(std::string_view name, const TaskPermission& permission,
+               std::size_t grain);
+
+ protected:
+  // call f(data, range) for chunks of [0, n) and wait for all of them.
+  void run_(const Context* ctx, std::size_t n, ChunkFunc f, void* data);
+
+ private:
+  void run_chunks_();
+  bool next_chunk_(ParallelRange* range);
+};
+
+// ParallelForTask.
+template <typename SizeF, typename F, typename SizeArgs, typename Args>
+class ParallelForTask;
+
+template <typename SizeF, typename F, typename... SizeArgs, typename... Args>
+class ParallelForTask<SizeF, F, t9::type_list<SizeArgs...>,
+                      t9::type_list<ParallelRange, Args...>>
+    : public ParallelTask {
+ private:
+  SizeF size_func_;
+  F func_;
+
+ public:
+  ParallelForTask(std::string_view name, ParallelFor<SizeF, F> f)
+      : ParallelTask(name, make_task_permission<SizeArgs..., Args...>(),
+                     f.grain),
+        size_func_(std::move(f.size_func)),
+        func_(std::move(f.func)) {}
+
+ protected:
+  virtual void on_exec_task(const Context* ctx, TaskWork* work) override {
+    std::size_t n =
+        size_func_(task_traits<SizeArgs>::apply_args(ctx, work)...);
+    // every chunk shares the args.
+    std::tuple<Args...> args(task_traits<Args>::apply_args(ctx, work)...);
+    auto chunk = [this, &args](ParallelRange r) {
+      std::apply([this, r](auto&&... xs) { func_(r, xs...); }, args);
+    };
+    using chunk_type = decltype(chunk);
+    run_(
+        ctx, n,
+        [](void* data, ParallelRange r) {
+          (*static_cast<chunk_type*>(data))(r);
+        },
+        &chunk);
+  }
+};
+
+// make_parallel_for_task.
+template <typename SizeF, typename F>
+inline std::shared_ptr<Task> make_parallel_for_task(
+    std::string_view name, ParallelFor<SizeF, F> f) {
+  using task_type = ParallelForTask<SizeF, F, t9::args_type<SizeF>,
+                                    t9::args_type<F>>;
+  return std::make_shared<task_type>(name, std::move(f));
+}
+
+}  // namespace task
@@ -18,6 +18,8 @@ struct Phase {
 };
 
 // PhaseData.
+// a group of tasks. phases order tasks only where their resources
+// conflict, the scheduler runs the whole frame as one graph.
 class PhaseData {
  private:
   PhaseId id_ = 0;
@@ -27,9 +29,6 @@ class PhaseData {
  public:
   PhaseData(PhaseId id, std::string_view name) : id_(id), name_(name) {}
 
-  void setup_task_dependencies();
-  void run(const Context& ctx);
-
   void add_task(std::shared_ptr<Task> task);
 
   PhaseId id() const { return id_; }
@@ -0,0 +1,217 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+#include "scheduler.h"
+
+namespace task {
+
+namespace {
+
+std::atomic<std::uint64_t> next_profiler_id = 1;
+
+// a job, or the helpers of a job.
+using ProfileKey = std::pair<const Job*, bool>;
+
+// the buffer of the current thread, for the profiler with |id|.
+struct ThreadBufferCache {
+  std::uint64_t id = 0;
+  void* buffer = nullptr;
+};
+thread_local ThreadBufferCache tls_buffer_cache;
+
+// nearest rank, |ns| sorted.
+double percentile(const std::vector<std::uint64_t>& ns, double p) {
+  auto rank = static_cast<std::size_t>(std::ceil(p * ns.size()));
+  auto i = std::min(ns.size() - 1, rank > 0 ? rank - 1 : 0);
+  return ns[i] / 1000.0;
+}
+
+void write_json_string(std::ostream& out, std::string_view s) {
+  static const char hex[] = "0123456789abcdef";
+  out << '"';
+  for (auto c : s) {
+    switch (c) {
+      case '"':
+        out << "\\\"";
+        break;
+      case '\\':
+        out << "\\\\";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          out << "\\u00" << hex[(c >> 4) & 0xf] << hex[c & 0xf];
+        } else {
+          out << c;
+        }
+        break;
+    }
+  }
+  out << '"';
+}
+
+}  // namespace
+
+// Profiler.
+Profiler::Profiler(std::size_t capacity)
+    : id_(next_profiler_id++),
+      capacity_(std::max<std::size_t>(capacity, 1)),
+      epoch_(std::chrono::steady_clock::now()) {}
+
+void Profiler::clear() {
+  std::unique_lock lock(mutex_);
+  for (auto& buffer : buffers_) {
+    buffer->sample_n = 0;
+  }
+}
+
+std::uint64_t Profiler::dropped_count() const {
+  std::unique_lock lock(mutex_);
+  std::uint64_t n = 0;
+  for (auto& buffer : buffers_) {
+    if (buffer->sample_n > capacity_) n += buffer->sample_n - capacity_;
+  }
+  return n;
+}
+
+std::vector<ProfileSample> Profiler::samples() const {
+  std::unique_lock lock(mutex_);
+  std::vector<ProfileSample> samples;
+  for (auto& buffer : buffers_) {
+    auto n = buffer->sample_n;
+    for (auto i = n > capacity_ ? n - capacity_ : 0; i < n; ++i) {
+      samples.emplace_back(buffer->samples[i % capacity_]);
+    }
+  }
+  std::sort(samples.begin(), samples.end(), [](auto& a, auto& b) {
+    return a.start_ns < b.start_ns;
+  });
+  return samples;
+}
+
+std::vector<ProfileStats> Profiler::stats() const {
+  // the helpers of a job share one row.
+  auto key_of = [](const Job* job) {
+    return job->owner() ? ProfileKey{job->owner(), true}
+                        : ProfileKey{job, false};
+  };
+  std::map<ProfileKey, std::vector<std::uint64_t>> durations;
+  std::vector<std::pair<ProfileKey, const Job*>> jobs;
+  for (auto& sample : samples()) {
+    if (sample.end_ns < sample.start_ns) continue;
+    auto key = key_of(sample.job);
+    auto& ns = durations[key];
+    if (ns.empty()) {
+      jobs.emplace_back(key, sample.job);
+    }
+    ns.emplace_back(sample.end_ns - sample.start_ns);
+  }
+  std::vector<ProfileStats> stats;
+  for (auto& [key, job] : jobs) {
+    auto& ns = durations[key];
+    std::sort(ns.begin(), ns.end());
+    ProfileStats s;
+    s.name = job->name();
+    s.count = ns.size();
+    s.p50 = percentile(ns, 0.5);
+    s.p90 = percentile(ns, 0.9);
+    s.p99 = percentile(ns, 0.99);
+    s.max = ns.back() / 1000.0;
+    stats.emplace_back(s);
+  }
+  return stats;
+}
+
+void Profiler::write_chrome_trace(std::ostream& out,
+                                  const Scheduler* scheduler) const {
+  std::unordered_map<const Job*, std::string_view> phases;
+  if (scheduler) {
+    for (auto& phase : scheduler->phases()) {
+      for (auto& task : phase->tasks()) {
+        phases.emplace(task.get(), phase->name());
+      }
+    }
+  }
+  auto flags = out.flags();
+  auto precision = out.precision();
+  out << std::fixed << std::setprecision(3);
+  out << "{\"traceEvents\":[";
+  bool is_first = true;
+  for (auto& sample : samples()) {
+    if (sample.end_ns < sample.start_ns) continue;
+    out << (is_first ? "\n" : ",\n");
+    is_first = false;
+    out << "{\"name\":";
+    write_json_string(out, sample.job->name());
+    auto job = sample.job->owner() ? sample.job->owner() : sample.job;
+    if (auto it = phases.find(job); it != phases.end()) {
+      out << ",\"cat\":";
+      write_json_string(out, it->second);
+    }
+    out << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << sample.thread
+        << ",\"ts\":" << sample.start_ns / 1000.0
+        << ",\"dur\":" << (sample.end_ns - sample.start_ns) / 1000.0
+        << ",\"args\":{\"frame\":" << sample.frame << "}}";
+  }
+  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  out.flags(flags);
+  out.precision(precision);
+}
+
+/*virtual*/ void Profiler::on_pre_exec_job(Job* job) /*override*/ {
+  auto buffer = thread_buffer_();
+  auto& sample = buffer->samples[buffer->sample_n++ % capacity_];
+  sample.job = job;
+  sample.thread = buffer->thread;
+  sample.frame = frame_.load(std::memory_order_relaxed);
+  sample.end_ns = 0;
+  sample.start_ns = now_ns_();
+}
+/*virtual*/ void Profiler::on_post_exec_job(Job* /*job*/) /*override*/ {
+  auto end_ns = now_ns_();
+  auto buffer = thread_buffer_();
+  // jobs do not nest: a thread runs a job to the end before taking the
+  // next, so the job ending is the last sample begun.
+  if (buffer->sample_n == 0) return;
+  buffer->samples[(buffer->sample_n - 1) % capacity_].end_ns = end_ns;
+}
+
+void Profiler::reserve_threads(std::size_t thread_n) {
+  std::unique_lock lock(mutex_);
+  buffers_.reserve(thread_n);
+  while (buffers_.size() < thread_n) {
+    new_buffer_();
+  }
+}
+
+// hands the buffer to a new thread, the only time it takes the mutex.
+Profiler::ThreadBuffer* Profiler::thread_buffer_() {
+  auto& cache = tls_buffer_cache;
+  if (cache.id == id_) return static_cast<ThreadBuffer*>(cache.buffer);
+  std::unique_lock lock(mutex_);
+  auto buffer = claimed_n_ < buffers_.size() ? buffers_[claimed_n_].get()
+                                             : new_buffer_();
+  ++claimed_n_;
+  cache.id = id_;
+  cache.buffer = buffer;
+  return buffer;
+}
+
+Profiler::ThreadBuffer* Profiler::new_buffer_() {
+  auto& buffer = buffers_.emplace_back(std::make_unique<ThreadBuffer>());
+  buffer->thread = static_cast<std::uint32_t>(buffers_.size() - 1);
+  buffer->samples.resize(capacity_);
+  return buffer.get();
+}
+
+std::uint64_t Profiler::now_ns_() const {
+  auto d = std::chrono::steady_clock::now() - epoch_;
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+}
+
+}  // namespace task
@@ -0,0 +1,100 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+#include "job.h"
+#include "t9/noncopyable.h"
+
+namespace task {
+
+class Scheduler;
+
+// ProfileSample.
+struct ProfileSample {
+  const Job* job = nullptr;
+  std::uint64_t start_ns = 0;
+  std::uint64_t end_ns = 0;
+  std::uint32_t thread = 0;
+  std::uint32_t frame = 0;
+};
+
+// ProfileStats.
+// durations of one job across frames, or of all the helpers of a job,
+// in microseconds.
+struct ProfileStats {
+  std::string_view name;
+  std::size_t count = 0;
+  double p50 = 0;
+  double p90 = 0;
+  double p99 = 0;
+  double max = 0;
+};
+
+// Profiler.
+// times every job run by a JobExecutor it observes. each thread writes
+// only its own buffer, a ring of the latest |capacity| samples allocated
+// up front, so the oldest samples are overwritten rather than the buffer
+// grown while timing. read the samples once the executor has joined.
+class Profiler : private t9::NonCopyable, public JobObserver {
+ public:
+  static constexpr std::size_t SAMPLE_CAPACITY = 1 << 14;
+
+ private:
+  // ThreadBuffer.
+  struct ThreadBuffer {
+    std::uint32_t thread = 0;
+    std::vector<ProfileSample> samples;
+    // samples written so far, the next one goes to samples[n % capacity].
+    std::uint64_t sample_n = 0;
+  };
+
+ private:
+  const std::uint64_t id_;
+  const std::size_t capacity_;
+  const std::chrono::steady_clock::time_point epoch_;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+  std::size_t claimed_n_ = 0;
+  mutable std::mutex mutex_;
+  std::atomic<std::uint32_t> frame_ = 0;
+
+ public:
+  explicit Profiler(std::size_t capacity = SAMPLE_CAPACITY);
+  virtual ~Profiler() = default;
+
+  void next_frame() { ++frame_; }
+  std::uint32_t frame() const { return frame_; }
+
+  void clear();
+
+  // allocate the buffers of |thread_n| threads now rather than on their
+  // first job. call while no job runs.
+  void reserve_threads(std::size_t thread_n);
+
+  std::size_t capacity() const { return capacity_; }
+  // samples overwritten before being read, over all threads.
+  std::uint64_t dropped_count() const;
+
+  std::vector<ProfileSample> samples() const;
+  std::vector<ProfileStats> stats() const;
+  // Chrome/Perfetto trace event JSON. phases come from |scheduler|.
+  void write_chrome_trace(std::ostream& out,
+                          const Scheduler* scheduler = nullptr) const;
+
+ public:
+  // JobObserver.
+  virtual void on_pre_exec_job(Job* job) override;
+  virtual void on_post_exec_job(Job* job) override;
+
+ private:
+  ThreadBuffer* thread_buffer_();
+  ThreadBuffer* new_buffer_();
+  std::uint64_t now_ns_() const;
+};
+
+}  // namespace task
@@ -1,16 +1,185 @@
 #include "scheduler.h"
 
 #include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <set>
+#include <unordered_map>
+
+#include "job.h"
 
 namespace task {
 
+namespace {
+
+// Access.
+// the tasks a later access of a resource must wait for. earlier accesses
+// are reached through them.
+struct Access {
+  std::size_t writer = NPOS;
+  std::vector<std::size_t> readers;
+
+  static constexpr std::size_t NPOS = static_cast<std::size_t>(-1);
+};
+
+// Ancestors.
+// one bit per task, for each task.
+class Ancestors {
+ private:
+  std::size_t word_n_ = 0;
+  std::vector<std::uint64_t> bits_;
+
+ public:
+  explicit Ancestors(std::size_t n)
+      : word_n_((n + 63) / 64), bits_(n * word_n_) {}
+
+  bool test(std::size_t i, std::size_t j) const {
+    return (bits_[i * word_n_ + j / 64] >> (j % 64)) & 1;
+  }
+  // |j| and its ancestors become ancestors of |i|.
+  void merge(std::size_t i, std::size_t j) {
+    auto dst = &bits_[i * word_n_];
+    auto src = &bits_[j * word_n_];
+    for (std::size_t w = 0; w < word_n_; ++w) {
+      dst[w] |= src[w];
+    }
+    dst[j / 64] |= std::uint64_t(1) << (j % 64);
+  }
+};
+
+}  // namespace
+
+// tasks wait only for the last writer, or the readers since it, of each
+// resource they touch; the rest of the conflicts follow through those.
+// candidates are then linked nearest first and skipped if already
+// reachable, which leaves the transitive reduction.
 void Scheduler::setup_task_dependencies() {
-  std::for_each(phases_.begin(), phases_.end(),
-                [](auto& p) { p->setup_task_dependencies(); });
+  tasks_.clear();
+  bool has_present = false;
+  for (auto& phase : phases_) {
+    if (is_pipelined_ && phase->id() == present_phase_id_) {
+      present_index_ = tasks_.size();
+      has_present = true;
+    }
+    for (auto& task : phase->tasks()) {
+      tasks_.emplace_back(task.get());
+    }
+  }
+  if (!has_present) {
+    present_index_ = tasks_.size();
+  }
+
+  // topological order. when pipelined, the present tasks of a frame come
+  // before the simulation of the next.
+  std::vector<Task*> order(tasks_.begin() + present_index_, tasks_.end());
+  order.insert(order.end(), tasks_.begin(), tasks_.begin() + present_index_);
+  auto simulation_index = order.size() - present_index_;
+  std::set<t9::type_int> buffers;
+  for (auto task : order) {
+    task->clear_dependencies();
+    const auto& permission = task->permission();
+    buffers.insert(permission.buffers.begin(), permission.buffers.end());
+  }
+
+  std::unordered_map<t9::type_int, Access> accesses;
+  Ancestors ancestors(order.size());
+  std::vector<std::size_t> candidates;
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    if (i == simulation_index && i != 0) {
+      // a FrameBuffer of the next frame is another copy.
+      for (auto b : buffers) {
+        accesses.erase(b);
+      }
+    }
+    auto task = order[i];
+    const auto& permission = task->permission();
+    candidates.clear();
+    for (auto r : permission.writes) {
+      auto& access = accesses[r];
+      if (access.writer != Access::NPOS) {
+        candidates.emplace_back(access.writer);
+      }
+      candidates.insert(candidates.end(), access.readers.begin(),
+                        access.readers.end());
+      access.writer = i;
+      access.readers.clear();
+    }
+    for (auto r : permission.reads) {
+      if (permission.writes.count(r)) continue;
+      auto& access = accesses[r];
+      if (access.writer != Access::NPOS) {
+        candidates.emplace_back(access.writer);
+      }
+      access.readers.emplace_back(i);
+    }
+    std::sort(candidates.begin(), candidates.end(), std::greater<>());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                     candidates.end());
+    std::size_t level = 0;
+    for (auto j : candidates) {
+      level = std::max(level, order[j]->level() + 1);
+      if (ancestors.test(i, j)) continue;
+      task->add_dependency(order[j]);
+      ancestors.merge(i, j);
+    }
+    task->set_level(level);
+  }
+
+  // submit by level, so the roots are queued first.
+  auto by_level = [](auto a, auto b) { return a->level() < b->level(); };
+  std::stable_sort(tasks_.begin(), tasks_.begin() + present_index_, by_level);
+  std::stable_sort(tasks_.begin() + present_index_, tasks_.end(), by_level);
 }
 void Scheduler::run(const Context& ctx) {
-  std::for_each(phases_.begin(), phases_.end(),
-                [&ctx](auto& p) { p->run(ctx); });
+  auto executor = ctx.get<JobExecutor>();
+  assert(executor);
+  auto present = tasks_.begin() + present_index_;
+  // reset every task first, a finished task releases its successors.
+  std::for_each(tasks_.begin(), tasks_.end(), [&ctx](auto task) {
+    task->set_context(&ctx);
+    task->reset_state();
+  });
+  if (!is_pipelined_) {
+    std::for_each(tasks_.begin(), tasks_.end(),
+                  [executor](auto task) { executor->submit(task); });
+  } else if (!is_primed_) {
+    // nothing to present yet, only simulate the first frame.
+    std::for_each(present, tasks_.end(), [](auto task) {
+      for (auto successor : task->successors()) {
+        successor->release();
+      }
+    });
+    std::for_each(tasks_.begin(), present, [executor](auto task) {
+      task->set_frame(0);
+      executor->submit(task);
+    });
+    is_primed_ = true;
+  } else {
+    auto frame = frame_ + 1;
+    for (auto& f : advance_funcs_) {
+      f(frame);
+    }
+    std::for_each(present, tasks_.end(), [this, executor](auto task) {
+      task->set_frame(frame_);
+      executor->submit(task);
+    });
+    std::for_each(tasks_.begin(), present, [frame, executor](auto task) {
+      task->set_frame(frame);
+      executor->submit(task);
+    });
+    frame_ = frame;
+  }
+  executor->kick();
+  executor->join();
+}
+
+void Scheduler::set_pipelined(PhaseId present_phase_id) {
+  present_phase_id_ = present_phase_id;
+  is_pipelined_ = true;
+}
+void Scheduler::add_advance_func(AdvanceFunc f) {
+  advance_funcs_.emplace_back(std::move(f));
 }
 
 bool Scheduler::add_phase(std::unique_ptr<PhaseData> p) {
@@ -1,20 +1,49 @@
 #pragma once
+#include <functional>
 #include <list>
 #include <memory>
+#include <vector>
 
 #include "phase.h"
 
 namespace task {
 
 // Scheduler.
+// runs every task of a frame as one graph. a task waits for an earlier
+// task, in phase order, only if their permissions conflict, so a slow task
+// holds back only the tasks that touch its resources.
+//
+// when pipelined, the phases from the present phase on present frame N
+// while the phases before it simulate frame N+1, in the same run(). the
+// present tasks then wait for nothing in the simulation, which finished
+// in the previous run(), and a simulation task waits for a present task
+// only where they share a resource that is not a FrameBuffer.
 class Scheduler {
+ public:
+  using AdvanceFunc = std::function<void(std::size_t)>;
+
  private:
   std::list<std::unique_ptr<PhaseData>> phases_;
+  std::vector<Task*> tasks_;
+  std::vector<AdvanceFunc> advance_funcs_;
+  PhaseId present_phase_id_ = 0;
+  bool is_pipelined_ = false;
+  std::size_t present_index_ = 0;
+  // the last simulated frame.
+  std::size_t frame_ = 0;
+  bool is_primed_ = false;
 
  public:
   void setup_task_dependencies();
   void run(const Context& ctx);
 
+  // call before setup_task_dependencies().
+  void set_pipelined(PhaseId present_phase_id);
+  // |f(frame)| starts a FrameBuffer on |frame|.
+  void add_advance_func(AdvanceFunc f);
+  bool is_pipelined() const { return is_pipelined_; }
+  std::size_t task_count() const { return tasks_.size(); }
+
   bool add_phase(std::unique_ptr<PhaseData> p);
   bool insert_phase(PhaseId next_id, std::unique_ptr<PhaseData> p);
 
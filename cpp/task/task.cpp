@@ -1,32 +1,29 @@
 #include "task.h"
 
+#include <algorithm>
+
 namespace task {
 
 Task::Task(std::string_view name, const TaskPermission& permission)
-    : Job(name), permission_(permission) {}
+    : Job(name), permission_(permission) {
+  set_main_thread(permission.is_main_thread);
+}
 
 bool Task::add_dependency(Task* task) {
-  if (is_depended_(task)) return false;
+  auto it = std::find(dependencies_.begin(), dependencies_.end(), task);
+  if (it != dependencies_.end()) return false;
   dependencies_.emplace_back(task);
+  task->add_successor(this);
   return true;
 }
-
-/*virtual*/ bool Task::on_can_exec() const /*override*/ {
-  for (auto task : dependencies_) {
-    if (!task->is_state(State::Done)) return false;
-  }
-  return true;
+void Task::clear_dependencies() {
+  dependencies_.clear();
+  level_ = 0;
+  clear_links();
 }
+
 /*virtual*/ void Task::on_exec() /*override*/ {
   on_exec_task(context_, &work_);
 }
 
-bool Task::is_depended_(Task* task) const {
-  for (auto it : dependencies_) {
-    if (it == task) return true;
-    if (it->is_depended_(task)) return true;
-  }
-  return false;
-}
-
 }  // namespace task
\ No newline at end of file
@@ -1,7 +1,7 @@
 #pragma once
 #include <deque>
-#include <functional>
 #include <string>
+#include <utility>
 
 #include "context.h"
 #include "job.h"
@@ -18,6 +18,7 @@ class Task : private t9::NonCopyable, public Job {
   TaskPermission permission_;
   TaskWork work_;
   std::deque<Task*> dependencies_;
+  std::size_t level_ = 0;
   const Context* context_ = nullptr;
 
  public:
@@ -25,36 +26,36 @@ class Task : private t9::NonCopyable, public Job {
   virtual ~Task() = default;
 
   void set_context(const Context* ctx) { context_ = ctx; }
+  void set_frame(std::size_t frame) { work_.set_frame(frame); }
 
   const TaskPermission& permission() const { return permission_; }
 
   bool add_dependency(Task* task);
-  std::deque<Task*> dependencies() const { return dependencies_; }
+  void clear_dependencies();
+  const std::deque<Task*>& dependencies() const { return dependencies_; }
+
+  // the longest chain of dependencies before this task.
+  std::size_t level() const { return level_; }
+  void set_level(std::size_t level) { level_ = level; }
 
  protected:
   // Job.
-  virtual bool on_can_exec() const override;
   virtual void on_exec() override;
 
  protected:
   virtual void on_exec_task(const Context* ctx, TaskWork* work) = 0;
-
- private:
-  bool is_depended_(Task* task) const;
 };
 
 // FuncTask.
-template <typename... Args>
+// holds F itself, so a call is direct and never allocates.
+template <typename F, typename... Args>
 class FuncTask : public Task {
  private:
-  using FuncType = std::function<void(Args...)>;
-
- private:
-  FuncType func_;
+  F func_;
 
  public:
-  FuncTask(std::string_view name, FuncType f)
-      : Task(name, make_task_permission<Args...>()), func_(f) {}
+  FuncTask(std::string_view name, F f)
+      : Task(name, make_task_permission<Args...>()), func_(std::move(f)) {}
 
  protected:
   virtual void on_exec_task(const Context* ctx, TaskWork* work) override {
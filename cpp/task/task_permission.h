@@ -9,6 +9,10 @@ namespace task {
 struct TaskPermission {
   std::set<t9::type_int> writes;
   std::set<t9::type_int> reads;
+  // per-frame copies, see FrameBuffer.
+  std::set<t9::type_int> buffers;
+  // run on the thread that calls App::update, see MainThread.
+  bool is_main_thread = false;
 
   template <typename T>
   void set_write() {
@@ -19,6 +23,14 @@ struct TaskPermission {
     reads.emplace(t9::type2int<T>::value());
   }
 
+  template <typename T>
+  void set_buffered() {
+    buffers.emplace(t9::type2int<T>::value());
+  }
+
+  bool is_buffered(t9::type_int i) const {
+    return buffers.find(i) != buffers.end();
+  }
   bool is_conflict_write(t9::type_int i) const {
     if (writes.find(i) != writes.end()) return true;
     if (reads.find(i) != reads.end()) return true;
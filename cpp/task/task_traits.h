@@ -53,6 +53,21 @@ struct task_traits<const T*> {
   }
 };
 
+// MainThread.
+// a task taking this runs on the thread that calls App::update, e.g. for
+// SDL or OpenGL calls.
+struct MainThread {};
+
+template <>
+struct task_traits<MainThread> {
+  static void set_permission(TaskPermission* permission) {
+    permission->is_main_thread = true;
+  }
+  static MainThread apply_args(const Context* /*ctx*/, TaskWork* /*work*/) {
+    return MainThread{};
+  }
+};
+
 namespace detail {
 
 inline void set_task_permission(TaskPermission*, t9::type_list<>) {}
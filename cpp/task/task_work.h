@@ -16,8 +16,12 @@ struct EventReaderIndex {
 class TaskWork {
  private:
   std::unordered_map<t9::type_int, EventReaderIndex> event_reader_indices_;
+  std::size_t frame_ = 0;
 
  public:
+  void set_frame(std::size_t frame) { frame_ = frame; }
+  std::size_t frame() const { return frame_; }
+
   template <typename T>
   std::size_t* event_reader_index_ptr() {
     auto i = t9::type2int<T>::value();
@@ -0,0 +1,95 @@
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "app.h"
+#include "profiler.h"
+#include "t9/check.h"
+
+// counts global allocations while g_count is set. steady-state frames
+// must not allocate.
+namespace {
+
+std::atomic<long> g_allocs = 0;
+std::atomic<bool> g_count = false;
+
+struct A {
+  int v = 0;
+};
+struct B {
+  long v = 0;
+};
+struct State {
+  int x = 0;
+};
+
+constexpr int WARM_UP_N = 100;
+constexpr int FRAME_N = 10000;
+
+}  // namespace
+
+void* operator new(std::size_t n) {
+  if (g_count) ++g_allocs;
+  if (auto p = std::malloc(n ? n : 1)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+// alloc_test [pipelined] [profiled]
+int main(int argc, char** argv) {
+  task::App app;
+  task::JobSettings settings;
+  settings.thread_n = 4;
+  app.context.add_with<task::JobSettings>(settings);
+  app.context.add_with<A>();
+  app.context.add_with<B>();
+  app.add_event<int>();
+  app.add_frame_resource<State>();
+  task::Profiler* profiler = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "pipelined") == 0) app.set_pipelined();
+    if (std::strcmp(argv[i], "profiled") == 0) {
+      profiler = app.context.add_with<task::Profiler>();
+    }
+  }
+
+  app.add_task("a", [](A* a) { ++a->v; });
+  app.add_task("b", [](const A& a, B* b) { b->v += a.v; });
+  app.add_task("send", [](task::EventSender<int> s) { s.send(1); });
+  app.add_task("recv", [](task::EventReceiver<int> r) { r.each([](int) {}); });
+  app.add_task("sim", [](task::Frame<State> s) { ++s->x; });
+  app.add_task("par", task::parallel_for(
+                          1000, [](task::ParallelRange r, const A&) {
+                            volatile long x = 0;
+                            for (auto i : r) x += i;
+                          }));
+  app.add_task_in_phase<task::LastPhase>(
+      "main", [](task::MainThread, task::Frame<const State>) {});
+  // more tasks than the initial capacity of the job deques.
+  std::array<long, 16> captured{};
+  for (int i = 0; i < 600; ++i) {
+    app.add_task("many", [captured](const B&) { (void)captured; });
+  }
+
+  app.set_runner([](task::App* app) {
+    for (int i = 0; i < WARM_UP_N; ++i) {
+      app->update();
+    }
+    g_count = true;
+    for (int i = 0; i < FRAME_N; ++i) {
+      app->update();
+    }
+    g_count = false;
+  });
+  app.run();
+
+  std::printf("allocations over %d frames: %ld\n", FRAME_N, g_allocs.load());
+  // at least one ring buffer has wrapped.
+  CHECK(!profiler || profiler->samples().size() >= profiler->capacity());
+  CHECK(g_allocs == 0);
+  return 0;
+}
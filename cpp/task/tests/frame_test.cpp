@@ -0,0 +1,49 @@
+#include <vector>
+
+#include "app.h"
+#include "frame.h"
+#include "t9/check.h"
+
+namespace {
+
+struct State {
+  int x = 0;
+};
+struct Presented {
+  std::vector<int> values;
+};
+
+constexpr int FRAME_N = 20;
+
+}  // namespace
+
+// when pipelined, each update presents the frame simulated by the one
+// before it, while the next frame is simulated from a copy.
+int main() {
+  task::App app;
+  task::JobSettings settings;
+  settings.thread_n = 4;
+  app.context.add_with<task::JobSettings>(settings);
+  app.context.add_with<Presented>();
+  app.add_frame_resource<State>();
+  app.set_pipelined();
+  app.add_task("sim", [](task::Frame<State> s) { ++s->x; });
+  app.add_task_in_phase<task::LastPhase>(
+      "present", [](task::Frame<const State> s, Presented* presented) {
+        presented->values.emplace_back(s->x);
+      });
+  app.set_runner([](task::App* app) {
+    for (int i = 0; i < FRAME_N; ++i) {
+      app->update();
+    }
+  });
+  CHECK(app.run());
+
+  // the first update only simulates.
+  auto& values = app.context.get<Presented>()->values;
+  CHECK(values.size() == FRAME_N - 1);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    CHECK(values[i] == static_cast<int>(i) + 1);
+  }
+  return 0;
+}
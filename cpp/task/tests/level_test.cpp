@@ -0,0 +1,54 @@
+#include <map>
+#include <string>
+
+#include "app.h"
+#include "scheduler.h"
+#include "t9/check.h"
+
+namespace {
+
+struct X {
+  int v = 0;
+};
+struct Y {
+  int v = 0;
+};
+struct Z {
+  int v = 0;
+};
+
+}  // namespace
+
+// a diamond keeps its two middle tasks on one level, and the redundant
+// edge from its top to its bottom is reduced away.
+int main() {
+  task::App app;
+  task::JobSettings settings;
+  settings.thread_n = 2;
+  app.context.add_with<task::JobSettings>(settings);
+  app.context.add_with<X>();
+  app.context.add_with<Y>();
+  app.context.add_with<Z>();
+  app.add_task("a", [](X* x) { x->v = 1; });
+  app.add_task("b", [](const X& x, Y* y) { y->v = x.v + 1; });
+  app.add_task("c", [](const X& x, Z* z) { z->v = x.v + 2; });
+  app.add_task("d", [](const X& x, const Y& y, const Z& z) {
+    CHECK(x.v == 1 && y.v == 2 && z.v == 3);
+  });
+  CHECK(app.run());
+
+  std::map<std::string, const task::Task*> tasks;
+  auto scheduler = app.context.get<task::Scheduler>();
+  for (auto& phase : scheduler->phases()) {
+    for (auto& t : phase->tasks()) {
+      tasks[std::string(t->name())] = t.get();
+    }
+  }
+  CHECK(tasks.size() == 4);
+  CHECK(tasks["a"]->level() == 0);
+  CHECK(tasks["b"]->level() == 1);
+  CHECK(tasks["c"]->level() == 1);
+  CHECK(tasks["d"]->level() == 2);
+  CHECK(tasks["d"]->dependencies().size() == 2);
+  return 0;
+}
@@ -0,0 +1,46 @@
+#include <thread>
+
+#include "app.h"
+#include "t9/check.h"
+
+namespace {
+
+struct X {
+  int v = 0;
+};
+
+constexpr int FRAME_N = 20;
+
+}  // namespace
+
+// a MainThread task runs on the thread that calls App::update, even
+// between worker tasks on the same resource.
+int main() {
+  task::App app;
+  task::JobSettings settings;
+  settings.thread_n = 4;
+  app.context.add_with<task::JobSettings>(settings);
+  app.context.add_with<X>();
+  std::thread::id update_id;
+  int main_n = 0;
+  app.add_task("before", [](X* x) { ++x->v; });
+  app.add_task("main", [&](task::MainThread, X* x) {
+    CHECK(std::this_thread::get_id() == update_id);
+    ++x->v;
+    ++main_n;
+  });
+  app.add_task("after", [](X* x) { ++x->v; });
+  app.set_runner([&update_id](task::App* app) {
+    std::thread runner([&update_id, app]() {
+      update_id = std::this_thread::get_id();
+      for (int i = 0; i < FRAME_N; ++i) {
+        app->update();
+      }
+    });
+    runner.join();
+  });
+  CHECK(app.run());
+  CHECK(main_n == FRAME_N);
+  CHECK(app.context.get<X>()->v == 3 * FRAME_N);
+  return 0;
+}
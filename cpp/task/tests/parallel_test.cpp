@@ -0,0 +1,46 @@
+#include <cstddef>
+#include <vector>
+
+#include "app.h"
+#include "t9/check.h"
+
+namespace {
+
+constexpr std::size_t N = 100000;
+constexpr int FRAME_N = 20;
+
+struct Values {
+  std::vector<std::size_t> v = std::vector<std::size_t>(N);
+};
+
+}  // namespace
+
+// the chunks of a ParallelFor are stolen by the workers, and each index
+// runs exactly once per frame.
+int main() {
+  task::App app;
+  task::JobSettings settings;
+  settings.thread_n = 4;
+  app.context.add_with<task::JobSettings>(settings);
+  app.context.add_with<Values>();
+  app.add_task("add", task::parallel_for(
+                          N, [](task::ParallelRange r, Values* values) {
+                            for (auto i : r) values->v[i] += i;
+                          }));
+  int frame = 0;
+  app.add_task_in_phase<task::PostUpdatePhase>(
+      "sum", [&frame](const Values& values) {
+        ++frame;
+        std::size_t sum = 0;
+        for (auto x : values.v) sum += x;
+        CHECK(sum == N * (N - 1) / 2 * frame);
+      });
+  app.set_runner([](task::App* app) {
+    for (int i = 0; i < FRAME_N; ++i) {
+      app->update();
+    }
+  });
+  CHECK(app.run());
+  CHECK(frame == FRAME_N);
+  return 0;
+}
@@ -0,0 +1,46 @@
+#include <string>
+#include <vector>
+
+#include "app.h"
+#include "t9/check.h"
+
+namespace {
+
+struct Log {
+  std::vector<std::string> names;
+};
+
+constexpr int FRAME_N = 20;
+
+}  // namespace
+
+// a conflict chain across phases runs in phase order, whatever order the
+// tasks were added in.
+int main() {
+  task::App app;
+  task::JobSettings settings;
+  settings.thread_n = 4;
+  app.context.add_with<task::JobSettings>(settings);
+  app.context.add_with<Log>();
+  app.add_task_in_phase<task::PostUpdatePhase>(
+      "post", [](Log* log) { log->names.emplace_back("post"); });
+  app.add_task_in_phase<task::UpdatePhase>(
+      "update", [](Log* log) { log->names.emplace_back("update"); });
+  app.add_task_in_phase<task::PreUpdatePhase>(
+      "pre", [](Log* log) { log->names.emplace_back("pre"); });
+  app.set_runner([](task::App* app) {
+    for (int i = 0; i < FRAME_N; ++i) {
+      app->update();
+    }
+  });
+  CHECK(app.run());
+
+  auto& names = app.context.get<Log>()->names;
+  CHECK(names.size() == 3 * FRAME_N);
+  for (std::size_t i = 0; i < names.size(); i += 3) {
+    CHECK(names[i] == "pre");
+    CHECK(names[i + 1] == "update");
+    CHECK(names[i + 2] == "post");
+  }
+  return 0;
+}
@@ -0,0 +1,58 @@
+#include <map>
+#include <sstream>
+#include <string>
+
+#include "app.h"
+#include "profiler.h"
+#include "scheduler.h"
+#include "t9/check.h"
+
+namespace {
+
+struct A {
+  int v = 0;
+};
+
+constexpr int FRAME_N = 20;
+
+}  // namespace
+
+// the helpers of a ParallelFor are one "<task>/helper" row, and are traced
+// in the phase of their task.
+int main() {
+  task::App app;
+  task::JobSettings settings;
+  settings.thread_n = 4;
+  app.context.add_with<task::JobSettings>(settings);
+  app.context.add_with<A>();
+  auto profiler = app.context.add_with<task::Profiler>();
+  app.add_task("par", task::parallel_for(
+                          4096, [](task::ParallelRange r, const A&) {
+                            volatile long x = 0;
+                            for (auto i : r) x += i;
+                          }));
+  app.set_runner([](task::App* app) {
+    for (int i = 0; i < FRAME_N; ++i) {
+      app->update();
+    }
+  });
+  CHECK(app.run());
+
+  std::map<std::string, int> rows;
+  for (auto& s : profiler->stats()) {
+    ++rows[std::string(s.name)];
+  }
+  CHECK(rows["par"] == 1);
+  CHECK(rows["par/helper"] == 1);
+  CHECK(rows.size() == 2);
+  for (auto& s : profiler->stats()) {
+    if (s.name == "par") CHECK(s.count == FRAME_N);
+  }
+
+  std::ostringstream trace;
+  profiler->write_chrome_trace(trace, app.context.get<task::Scheduler>());
+  CHECK(trace.str().find(
+            "\"name\":\"par/helper\",\"cat\":\"UpdatePhase\"") !=
+        std::string::npos);
+  return 0;
+}
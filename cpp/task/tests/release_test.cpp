@@ -0,0 +1,44 @@
+#include <atomic>
+
+#include "app.h"
+#include "t9/check.h"
+
+namespace {
+
+struct X {
+  int v = 0;
+};
+
+constexpr int READER_N = 4;
+constexpr int FRAME_N = 50;
+
+std::atomic<int> g_reads{0};
+
+}  // namespace
+
+// readers are released by their writer, and the next writer only when
+// every reader has finished.
+int main() {
+  task::App app;
+  task::JobSettings settings;
+  settings.thread_n = 4;
+  app.context.add_with<task::JobSettings>(settings);
+  app.context.add_with<X>();
+  app.add_task("write", [](X* x) { ++x->v; });
+  for (int i = 0; i < READER_N; ++i) {
+    app.add_task("read", [](const X& x) {
+      CHECK(g_reads.load() / READER_N == x.v - 1);
+      ++g_reads;
+    });
+  }
+  app.add_task("check", [](X* x) { CHECK(g_reads == x->v * READER_N); });
+  app.set_runner([](task::App* app) {
+    for (int i = 0; i < FRAME_N; ++i) {
+      app->update();
+    }
+  });
+  CHECK(app.run());
+  CHECK(g_reads == FRAME_N * READER_N);
+  CHECK(app.context.get<X>()->v == FRAME_N);
+  return 0;
+}